@@ -0,0 +1,647 @@
+#include "Camera.h"
+#include "Dataset.h"
+#include "Marker.h"
+#include "MarkerDetector.h"
+#include "MarkerImageCache.h"
+#include "MarkerTracker.h"
+#include "PlanarPose.h"
+#include "PoseBatch.h"
+#include "PoseSweeps.h"
+#include "Undistortion.h"
+#include "Decoding.h"
+#include "GreyConversion.h"
+#include "Binarization.h"
+#include "Recognition.h"
+#include "RecognitionStages.h"
+#include "SoftwareRendering.h"
+#include "StreamingDetector.h"
+#include "Util.h"
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+// Heap allocation counter. On glibc we interpose the C allocator itself, because OpenCV
+// allocates Mat data with cv::fastMalloc(), i.e. posix_memalign() or memalign(), and
+// would be invisible to operator new. operator new ends up in malloc() as well.
+static std::atomic<long> allocationCount{ 0 };
+
+#ifdef __GLIBC__
+extern "C" {
+    void* __libc_malloc(std::size_t size);
+    void* __libc_calloc(std::size_t num, std::size_t size);
+    void* __libc_realloc(void* ptr, std::size_t size);
+    void* __libc_memalign(std::size_t alignment, std::size_t size);
+
+    void* malloc(std::size_t size) {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        return __libc_malloc(size);
+    }
+
+    void* calloc(std::size_t num, std::size_t size) {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        return __libc_calloc(num, size);
+    }
+
+    void* realloc(void* ptr, std::size_t size) {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        return __libc_realloc(ptr, size);
+    }
+
+    void* memalign(std::size_t alignment, std::size_t size) {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        return __libc_memalign(alignment, size);
+    }
+
+    void* aligned_alloc(std::size_t alignment, std::size_t size) {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        return __libc_memalign(alignment, size);
+    }
+
+    int posix_memalign(void** ptr, std::size_t alignment, std::size_t size) {
+        // a power of two multiple of sizeof(void*)
+        if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0)
+            return EINVAL;
+
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        void* result = __libc_memalign(alignment, size);
+
+        if (!result)
+            return ENOMEM;
+
+        *ptr = result;
+        return 0;
+    }
+}
+#else
+void* operator new(std::size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+
+    if (void* ptr = std::malloc(size ? size : 1))
+        return ptr;
+
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+#endif
+
+
+const int TEXTURE_SIZE       = 256;
+const int DEFAULT_ITERATIONS = 200;
+const int DATASET_STEPS      = 21;     // frames per sweep parameter of a written dataset
+
+
+struct Scene {
+    std::string         name;
+    Camera              camera;
+    std::vector<Marker> markers;
+};
+
+
+struct StageResult {
+    std::string name;
+    double      meanNs;
+    double      p50Ns;
+    double      p90Ns;
+    double      p99Ns;
+    double      allocations;
+};
+
+
+// Camera with the default field of view at the given resolution
+Camera createCamera(int width, int height) {
+    Camera camera;
+    double scale = double(width) / camera.imageWidth;
+
+    camera.imageWidth  = width;
+    camera.imageHeight = height;
+    camera.principalX  = width / 2.0;
+    camera.principalY  = height / 2.0;
+    camera.focalX     *= scale;
+    camera.focalY     *= scale;
+
+    return camera;
+}
+
+
+// A grid*grid board of slightly tilted markers at the given distance
+Scene createScene(int width, int height, int grid, double distance) {
+    Scene scene;
+    scene.camera = createCamera(width, height);
+    scene.name = std::to_string(width) + "x" + std::to_string(height) +
+        " markers=" + std::to_string(grid * grid) +
+        " z=" + std::to_string(distance).substr(0, 3);
+
+    double spacing = Marker::MARKER_SIZE * 1.5;
+    double offset = spacing * (grid - 1) / 2.0;
+    std::uint64_t maxId = std::uint64_t(1) << (Marker::NUM_SQUARES * Marker::NUM_SQUARES - 4);
+
+    for (int row = 0; row < grid; row++) {
+        for (int col = 0; col < grid; col++) {
+            int i = row * grid + col;
+
+            Translation t = { col * spacing - offset, offset - row * spacing, -distance };
+            Rotation r = { 10.0, -10.0, 15.0 * i };
+
+            scene.markers.push_back(Marker(std::uint32_t(i % maxId), t, r));
+        }
+    }
+
+    return scene;
+}
+
+
+double percentile(const std::vector<double>& sorted, double p) {
+    auto index = std::size_t(p * (sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+
+// Run setup() untimed and run() timed for each iteration
+StageResult measure(const std::string& name, int iterations,
+                    const std::function<void()>& setup,
+                    const std::function<void()>& run) {
+
+    std::vector<double> samples(iterations);
+    long allocations = 0;
+
+    for (int i = 0; i < iterations; i++) {
+        setup();
+
+        long allocationsBefore = allocationCount.load();
+        auto start = std::chrono::steady_clock::now();
+
+        run();
+
+        auto stop = std::chrono::steady_clock::now();
+        allocations += allocationCount.load() - allocationsBefore;
+
+        samples[i] = double(std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count());
+    }
+
+    std::sort(std::begin(samples), std::end(samples));
+    double mean = std::accumulate(std::begin(samples), std::end(samples), 0.0) / iterations;
+
+    return{ name, mean,
+        percentile(samples, 0.5), percentile(samples, 0.9), percentile(samples, 0.99),
+        double(allocations) / iterations };
+}
+
+
+// Deep copy, reusing the destination buffers
+void copyCandidates(const CandidateList& src, CandidateList& dst) {
+    dst.clear();
+
+    for (std::size_t i = 0; i < src.size(); i++) {
+        auto& candidate = dst.add();
+        candidate.quad = src[i].quad;
+        candidate.decoding = src[i].decoding;
+        src[i].image.copyTo(candidate.image);
+        src[i].integral.copyTo(candidate.integral);
+    }
+}
+
+
+std::vector<StageResult> benchmarkScene(const Scene& scene, int iterations) {
+    const Camera& camera = scene.camera;
+    auto noSetup = [] {};
+
+    // inputs of every stage, produced once by the previous stage
+    cv::Mat sceneRGB = renderScene(camera, scene.markers, TEXTURE_SIZE);
+    cv::Mat sceneGrey, sceneBinary;
+    cv::cvtColor(sceneRGB, sceneGrey, CV_RGB2GRAY);
+
+    std::vector<Contour> contours;
+    Contour quadBuffer;
+    findContours(sceneGrey, sceneBinary, contours);
+
+    CandidateList warped;
+    getPreciseQuads(sceneGrey, contours, MIN_CONTOUR_LEN, MIN_QUAD_AREA, quadBuffer, warped);
+    undistortMarkerImages(sceneGrey, warped, NORMALIZED_MARKER_SIZE);
+    integrateMarkerImages(warped);
+
+    DetectorParams warpParams;
+    CandidateList valid;
+    copyCandidates(warped, valid);
+    decodeMarkerCandidates(sceneGrey, valid, warpParams, VALID_MARKER_TOLERANCE);
+
+    typedef NormalizedLayout<Marker::NUM_SQUARES> Layout;
+
+    // per-stage outputs kept outside of the timed region
+    CandidateList candidates;
+    std::vector<Contour> contoursOut;
+    cv::Mat grey, binary;
+    MarkerDetector detector{ camera };
+
+    DetectorParams sampleParams;
+    sampleParams.decodeMode = DECODE_SAMPLE;
+    MarkerDetector sampleDetector{ camera, sampleParams };
+
+    DetectorParams serialParams;
+    serialParams.parallel = false;
+    MarkerDetector serialDetector{ camera, serialParams };
+
+    DetectorParams pyramidParams;
+    pyramidParams.minMarkerSizePx = 4 * MIN_PYRAMID_MARKER_SIZE;
+    MarkerDetector pyramidDetector{ camera, pyramidParams };
+
+    DetectorParams mixedParams;
+    mixedParams.gridSizes = { 3, 6 };
+    MarkerDetector mixedDetector{ camera, mixedParams };
+
+    DetectorParams warmParams;
+    warmParams.warmStartPose = true;
+    MarkerDetector warmDetector{ camera, warmParams };
+
+    DetectorParams adaptiveParams;
+    adaptiveParams.binarization = BINARIZE_ADAPTIVE;
+    MarkerDetector adaptiveDetector{ camera, adaptiveParams };
+    cv::Mat thresholdIntegral;
+    volatile double sink = 0.0;
+
+    std::vector<StageResult> results;
+
+    results.push_back(measure("cvtColor", iterations, noSetup, [&] {
+        cv::cvtColor(sceneRGB, grey, CV_RGB2GRAY);
+    }));
+
+    results.push_back(measure("cvtColor + threshold", iterations, noSetup, [&] {
+        cv::cvtColor(sceneRGB, grey, CV_RGB2GRAY);
+        cv::threshold(grey, binary, BINARIZATION_THRESHOLD, 0.0, CV_THRESH_TOZERO);
+    }));
+
+    results.push_back(measure(std::string("convertToGreyAndBinary ") + getGreyKernelName(), iterations, noSetup, [&] {
+        convertToGreyAndBinary(sceneRGB, grey, binary, int(BINARIZATION_THRESHOLD));
+    }));
+
+    results.push_back(measure("adaptiveThreshold", iterations, noSetup, [&] {
+        adaptiveThreshold(sceneGrey, thresholdIntegral, binary, adaptiveParams.adaptiveWindow, adaptiveParams.adaptiveOffset);
+    }));
+
+    results.push_back(measure("findContours", iterations, noSetup, [&] {
+        findContours(sceneGrey, binary, contoursOut);
+    }));
+
+    std::vector<ContourBand> bands;
+    int numBands = std::max(2, getNumContourBands(sceneGrey.rows, detector.getParams().bandOverlap, ThreadPool::shared().size()));
+
+    results.push_back(measure("findContoursTiled", iterations, noSetup, [&] {
+        findContoursTiled(sceneGrey, bands, numBands, detector.getParams().bandOverlap, &ThreadPool::shared(), contoursOut);
+    }));
+
+    results.push_back(measure("getPreciseQuads", iterations,
+        [&] { candidates.clear(); },
+        [&] { getPreciseQuads(sceneGrey, contours, MIN_CONTOUR_LEN, MIN_QUAD_AREA, quadBuffer, candidates); }));
+
+    results.push_back(measure("undistortMarkerImages", iterations,
+        [&] { copyCandidates(warped, candidates); },
+        [&] { undistortMarkerImages(sceneGrey, candidates, NORMALIZED_MARKER_SIZE); }));
+
+    results.push_back(measure("integrateMarkerImages", iterations,
+        [&] { copyCandidates(warped, candidates); },
+        [&] { integrateMarkerImages(candidates); }));
+
+    results.push_back(measure("decodeMarkerCandidates warp", iterations,
+        [&] { copyCandidates(warped, candidates); },
+        [&] { decodeMarkerCandidates(sceneGrey, candidates, warpParams, VALID_MARKER_TOLERANCE); }));
+
+    results.push_back(measure("decodeMarkerCandidates sample", iterations,
+        [&] { copyCandidates(warped, candidates); },
+        [&] { decodeMarkerCandidates(sceneGrey, candidates, sampleParams, VALID_MARKER_TOLERANCE); }));
+
+    results.push_back(measure("decodeMarkerCandidates 3+6", iterations,
+        [&] { copyCandidates(warped, candidates); },
+        [&] { decodeMarkerCandidates(sceneGrey, candidates, mixedParams, VALID_MARKER_TOLERANCE); }));
+
+    results.push_back(measure("getCellBits + getMarkerTurns + getId", iterations, noSetup, [&] {
+        for (std::size_t i = 0; i < valid.size(); i++) {
+            std::uint64_t bits = getCellBits<Layout>(valid[i].decoding.cells);
+            sink = getId<Layout>(bits, getMarkerTurns<Layout>(bits));
+        }
+    }));
+
+    results.push_back(measure("calculateScore", iterations, noSetup, [&] {
+        for (std::size_t i = 0; i < valid.size(); i++) {
+            sink = calculateScore<Layout>(valid[i].decoding.cells, valid[i].decoding.bits);
+        }
+    }));
+
+    results.push_back(measure("calculateTransformation", iterations, noSetup, [&] {
+        for (std::size_t i = 0; i < valid.size(); i++) {
+            sink = calculateTransformation(camera, valid[i].quad).t.z;
+        }
+    }));
+
+    PlanarPoseSolutions poseSolutions;
+
+    results.push_back(measure("solveSquarePose (closed form)", iterations, noSetup, [&] {
+        for (std::size_t i = 0; i < valid.size(); i++) {
+            sink = solveSquarePose(camera, valid[i].quad, Marker::MARKER_SIZE, 0, poseSolutions);
+        }
+    }));
+
+    SquarePoseBatch poseBatch{ camera };
+
+    results.push_back(measure("SquarePoseBatch (closed form)", iterations, noSetup, [&] {
+        poseBatch.clear();
+
+        for (std::size_t i = 0; i < valid.size(); i++) {
+            poseBatch.add(valid[i].quad);
+        }
+
+        poseBatch.solve(Marker::MARKER_SIZE, 0);
+        sink = double(poseBatch.size());
+    }));
+
+    Camera lensCamera = camera;
+    lensCamera.k1 = -0.1;
+    lensCamera.k2 = 0.02;
+
+    UndistortionMap undistortionMap{ lensCamera };
+    ContourFloat lensQuad;
+
+    results.push_back(measure("UndistortionMap (quad corners)", iterations, noSetup, [&] {
+        for (std::size_t i = 0; i < valid.size(); i++) {
+            lensQuad = valid[i].quad;
+            undistortionMap.undistort(lensQuad);
+            sink = lensQuad[0].x;
+        }
+    }));
+
+    results.push_back(measure("recognizeMarkers (total)", iterations, noSetup, [&] {
+        sink = double(recognizeMarkers(camera, sceneRGB).size());
+    }));
+
+    results.push_back(measure("MarkerDetector (total)", iterations, noSetup, [&] {
+        sink = double(detector.detect(sceneRGB).size());
+    }));
+
+    results.push_back(measure("MarkerDetector serial (total)", iterations, noSetup, [&] {
+        sink = double(serialDetector.detect(sceneRGB).size());
+    }));
+
+    // camera native NV12, luma read in place instead of converting to RGB and back
+    cv::Mat sceneNV12{ sceneGrey.rows * 3 / 2, sceneGrey.cols, CV_8UC1, cv::Scalar(128) };
+    sceneGrey.copyTo(sceneNV12.rowRange(0, sceneGrey.rows));
+
+    ImageBuffer bufferNV12;
+    bufferNV12.data = sceneNV12.data;
+    bufferNV12.width = sceneGrey.cols;
+    bufferNV12.height = sceneGrey.rows;
+    bufferNV12.stride = sceneNV12.step;
+    bufferNV12.format = PIXEL_NV12;
+
+    results.push_back(measure("MarkerDetector NV12 buffer (total)", iterations, noSetup, [&] {
+        sink = double(detector.detect(bufferNV12).size());
+    }));
+
+    // software rendering of the scene, marker images generated every time vs cached
+    results.push_back(measure("createMarkerImage (all markers)", iterations, noSetup, [&] {
+        for (const auto& marker : scene.markers) {
+            sink = double(createMarkerImage(marker, TEXTURE_SIZE).rows);
+        }
+    }));
+
+    results.push_back(measure("MarkerImageCache (all markers)", iterations, noSetup, [&] {
+        for (const auto& marker : scene.markers) {
+            sink = double(MarkerImageCache::shared().get(marker, TEXTURE_SIZE).rows);
+        }
+    }));
+
+    // pipelined: with backpressure, submit() returns at the pace of the slowest stage
+    {
+        StreamingParams streamingParams;
+        streamingParams.overflow = OVERFLOW_BLOCK;
+        StreamingDetector streaming{ camera, DetectorParams(), streamingParams };
+
+        std::atomic<bool> polling{ true };
+        std::thread poller{ [&] {
+            StreamingResult result;
+            while (polling) {
+                if (streaming.poll(result)) {
+                    sink = double(result.markers.size());
+                }
+                else {
+                    std::this_thread::yield();
+                }
+            }
+        } };
+
+        results.push_back(measure("StreamingDetector (per frame)", iterations, noSetup, [&] {
+            streaming.submit(sceneRGB);
+        }));
+
+        polling = false;
+        poller.join();
+    }
+
+    // static scene, so every frame but each redetectInterval-th one only searches regions
+    MarkerTracker tracker{ camera };
+    tracker.track(sceneRGB);
+
+    results.push_back(measure("MarkerTracker (steady state)", iterations, noSetup, [&] {
+        sink = double(tracker.track(sceneRGB).size());
+    }));
+
+    results.push_back(measure("MarkerDetector pyramid 2 (total)", iterations, noSetup, [&] {
+        sink = double(pyramidDetector.detect(sceneRGB).size());
+    }));
+
+    results.push_back(measure("MarkerDetector sample (total)", iterations, noSetup, [&] {
+        sink = double(sampleDetector.detect(sceneRGB).size());
+    }));
+
+    results.push_back(measure("MarkerDetector 3+6 (total)", iterations, noSetup, [&] {
+        sink = double(mixedDetector.detect(sceneRGB).size());
+    }));
+
+    // static scene, every pose is warm started from the previous frame
+    warmDetector.detect(sceneRGB);
+
+    results.push_back(measure("MarkerDetector warm start (total)", iterations, noSetup, [&] {
+        sink = double(warmDetector.detect(sceneRGB).size());
+    }));
+
+    results.push_back(measure("MarkerDetector adaptive (total)", iterations, noSetup, [&] {
+        sink = double(adaptiveDetector.detect(sceneRGB).size());
+    }));
+
+    std::cout << "\n" << scene.name <<
+        "  contours=" << contours.size() <<
+        " quads=" << warped.size() <<
+        " valid=" << valid.size() << "\n";
+
+    return results;
+}
+
+
+void printResults(const std::vector<StageResult>& results) {
+    auto coutFlags = std::cout.flags();
+    std::cout << std::fixed << std::setprecision(0);
+
+    std::cout <<
+        std::left  << std::setw(32) << "  stage" <<
+        std::right << std::setw(12) << "mean ns" <<
+        std::setw(12) << "p50 ns" <<
+        std::setw(12) << "p90 ns" <<
+        std::setw(12) << "p99 ns" <<
+        std::setw(12) << "allocs" << "\n";
+
+    for (const auto& r : results) {
+        std::cout <<
+            std::left  << std::setw(32) << ("  " + r.name) <<
+            std::right << std::setw(12) << r.meanNs <<
+            std::setw(12) << r.p50Ns <<
+            std::setw(12) << r.p90Ns <<
+            std::setw(12) << r.p99Ns <<
+            std::setw(12) << std::setprecision(1) << r.allocations << std::setprecision(0) << "\n";
+    }
+
+    std::cout.flags(coutFlags);
+}
+
+
+// MarkerPosBench --write-dataset: the benchmark plot sweeps of a single marker at 640x480
+int writeBenchmarkDataset(const std::string& path, int steps) {
+    Camera camera = createCamera(640, 480);
+    Marker marker(4, { 0.0, 0.0, -3.0 }, { 0.0, 0.0, 0.0 });
+
+    MarkerFrames frames = getBenchmarkSweeps(marker, steps);
+
+    if (!writeDataset(path, camera, frames)) {
+        std::cerr << "Can't write " << path << "\n";
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "Wrote " << frames.size() << " frames to " << path << "\n";
+    return EXIT_SUCCESS;
+}
+
+
+// MarkerPosBench --dataset: detector accuracy against the ground truth, then its timing,
+// on the frames of a dataset read in place from the mapped file
+int replayDataset(const std::string& path) {
+    Dataset dataset;
+
+    if (!dataset.open(path) || dataset.size() == 0) {
+        std::cerr << "Can't open dataset " << path << "\n";
+        return EXIT_FAILURE;
+    }
+
+    MarkerDetector detector(dataset.getCamera());
+    std::size_t numMarkers = 0, numFound = 0;
+    double sumDT = 0.0, maxDT = 0.0, sumDR = 0.0, maxDR = 0.0;
+
+    for (std::size_t i = 0; i < dataset.size(); i++) {
+        const auto& recognized = detector.detect(dataset.getFrame(i));
+
+        for (const auto& marker : dataset.getMarkers(i)) {
+            numMarkers++;
+
+            auto match = std::find_if(recognized.begin(), recognized.end(), [&marker](const MarkerScore& m) {
+                return m.marker.id == marker.id && m.marker.numSquares == marker.numSquares;
+            });
+
+            if (match == recognized.end())
+                continue;
+
+            double dt = distance(marker.t, match->marker.t);
+            double dr = maxAngleDiff(marker.r, match->marker.r);
+
+            numFound++;
+            sumDT += dt;
+            sumDR += dr;
+            maxDT = std::max(maxDT, dt);
+            maxDR = std::max(maxDR, dr);
+        }
+    }
+
+    std::size_t next = 0;
+    ImageBuffer frame;
+    volatile double sink = 0.0;
+
+    auto result = measure("MarkerDetector dataset (total)", int(dataset.size()),
+        [&] { frame = dataset.getFrame(next++); },
+        [&] { sink = double(detector.detect(frame).size()); });
+
+    const Camera& camera = dataset.getCamera();
+    auto coutFlags = std::cout.flags();
+    std::cout << std::fixed << std::setprecision(4);
+
+    std::cout << "\n" << path << "  " << camera.imageWidth << "x" << camera.imageHeight <<
+        " frames=" << dataset.size() << " markers=" << numMarkers << " found=" << numFound << "\n";
+
+    if (numFound > 0) {
+        std::cout <<
+            "  DT mean=" << sumDT / numFound << " max=" << maxDT << "\n"
+            "  DR mean=" << sumDR / numFound << " max=" << maxDR << " deg\n";
+    }
+
+    std::cout.flags(coutFlags);
+    printResults({ result });
+
+    return EXIT_SUCCESS;
+}
+
+
+int main(int argc, char* argv[]) {
+    // MarkerPosBench --write-dataset <file> [steps]
+    if (argc >= 3 && argc <= 4 && std::strcmp(argv[1], "--write-dataset") == 0) {
+        int steps = argc == 4 ? std::atoi(argv[3]) : DATASET_STEPS;
+
+        if (steps > 0)
+            return writeBenchmarkDataset(argv[2], steps);
+    }
+
+    // MarkerPosBench --dataset <file>
+    if (argc == 3 && std::strcmp(argv[1], "--dataset") == 0) {
+        return replayDataset(argv[2]);
+    }
+
+    int iterations = argc == 2 ? std::atoi(argv[1]) : argc == 1 ? DEFAULT_ITERATIONS : 0;
+
+    if (iterations <= 0) {
+        std::cerr <<
+            "Usage: " << argv[0] << " [iterations]\n"
+            "       " << argv[0] << " --write-dataset <file> [steps]\n"
+            "       " << argv[0] << " --dataset <file>\n";
+        return EXIT_FAILURE;
+    }
+
+    std::cout <<
+        "MarkerPosBench - recognition pipeline microbenchmarks\n"
+        "iterations per stage: " << iterations << "\n";
+
+    std::vector<Scene> scenes;
+
+    for (auto resolution : { cv::Size{ 640, 480 }, cv::Size{ 1920, 1080 }, cv::Size{ 3840, 2160 } }) {
+        for (int grid : { 1, 2, 4 }) {
+            for (double distance : { 3.0, 6.0 }) {
+                scenes.push_back(createScene(resolution.width, resolution.height, grid, distance));
+            }
+        }
+    }
+
+    for (const auto& scene : scenes) {
+        printResults(benchmarkScene(scene, iterations));
+    }
+
+    return EXIT_SUCCESS;
+}
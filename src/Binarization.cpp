@@ -0,0 +1,119 @@
+#include "Binarization.h"
+
+#include <algorithm>
+#include <cassert>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+
+// Pixels [from, to) of a row where the window spans the columns [x - radius, x + radius]
+// clipped to the image. top and bottom are the integral rows above and below the window.
+void thresholdRowScalar(const uchar* grey, uchar* binary, const int* top, const int* bottom,
+                        int from, int to, int cols, int radius, int height, int offset) {
+    for (int x = from; x < to; x++) {
+        int x1 = std::max(x - radius, 0);
+        int x2 = std::min(x + radius + 1, cols);
+        int area = (x2 - x1) * height;
+        int sum = bottom[x2] - bottom[x1] - top[x2] + top[x1];
+
+        // grey > sum / area + offset without dividing
+        binary[x] = grey[x] * area > sum + offset * area ? grey[x] : 0;
+    }
+}
+
+
+// Columns whose window isn't clipped horizontally, so the area is the same for all
+void thresholdRowInterior(const uchar* grey, uchar* binary, const int* top, const int* bottom,
+                          int from, int to, int radius, int area, int offset) {
+    const int* topLeft = top - radius;
+    const int* topRight = top + radius + 1;
+    const int* bottomLeft = bottom - radius;
+    const int* bottomRight = bottom + radius + 1;
+    int bias = offset * area;
+
+    int x = from;
+
+#if defined(__SSE2__)
+    const __m128i areaVec = _mm_set1_epi16(short(area));
+    const __m128i biasVec = _mm_set1_epi32(bias);
+    const __m128i zero = _mm_setzero_si128();
+
+    // sum + bias for 4 pixels
+    auto limit4 = [&](int i) {
+        __m128i tl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(topLeft + i));
+        __m128i tr = _mm_loadu_si128(reinterpret_cast<const __m128i*>(topRight + i));
+        __m128i bl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bottomLeft + i));
+        __m128i br = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bottomRight + i));
+        return _mm_add_epi32(_mm_sub_epi32(_mm_add_epi32(br, tl), _mm_add_epi32(bl, tr)), biasVec);
+    };
+
+    // grey * area for 8 pixels, as two halves of 4 32-bit products
+    auto scaled8 = [&](__m128i grey16, __m128i& low, __m128i& high) {
+        __m128i productLow = _mm_mullo_epi16(grey16, areaVec);
+        __m128i productHigh = _mm_mulhi_epu16(grey16, areaVec);
+        low = _mm_unpacklo_epi16(productLow, productHigh);
+        high = _mm_unpackhi_epi16(productLow, productHigh);
+    };
+
+    // 16 pixels per step
+    for (; x + 16 <= to; x += 16) {
+        __m128i g = _mm_loadu_si128(reinterpret_cast<const __m128i*>(grey + x));
+        __m128i g0, g1, g2, g3;
+
+        scaled8(_mm_unpacklo_epi8(g, zero), g0, g1);
+        scaled8(_mm_unpackhi_epi8(g, zero), g2, g3);
+
+        __m128i m0 = _mm_cmpgt_epi32(g0, limit4(x));
+        __m128i m1 = _mm_cmpgt_epi32(g1, limit4(x + 4));
+        __m128i m2 = _mm_cmpgt_epi32(g2, limit4(x + 8));
+        __m128i m3 = _mm_cmpgt_epi32(g3, limit4(x + 12));
+
+        // all-ones/zero 32-bit masks to bytes
+        __m128i mask = _mm_packs_epi16(_mm_packs_epi32(m0, m1), _mm_packs_epi32(m2, m3));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(binary + x), _mm_and_si128(g, mask));
+    }
+#endif
+
+    for (; x < to; x++) {
+        int sum = bottomRight[x] - bottomLeft[x] - topRight[x] + topLeft[x];
+        binary[x] = grey[x] * area > sum + bias ? grey[x] : 0;
+    }
+}
+
+
+void adaptiveThreshold(const cv::Mat& sceneGrey, cv::Mat& integral, cv::Mat& sceneBinary, int window, int offset) {
+    assert(sceneGrey.type() == CV_8UC1);
+    assert(window > 0 && window % 2 == 1);
+
+    // grey * area must fit into 32 bits, and area into 16 for the SIMD multiply
+    assert(window <= 255);
+
+    int rows = sceneGrey.rows;
+    int cols = sceneGrey.cols;
+    int radius = window / 2;
+
+    cv::integral(sceneGrey, integral, CV_32S);
+    sceneBinary.create(sceneGrey.size(), CV_8UC1);
+
+    // columns with a full width window
+    int interiorFrom = std::min(radius, cols);
+    int interiorTo = std::max(cols - radius - 1, interiorFrom);
+
+    for (int y = 0; y < rows; y++) {
+        int y1 = std::max(y - radius, 0);
+        int y2 = std::min(y + radius + 1, rows);
+        int height = y2 - y1;
+
+        const uchar* grey = sceneGrey.ptr<uchar>(y);
+        uchar* binary = sceneBinary.ptr<uchar>(y);
+        const int* top = integral.ptr<int>(y1);
+        const int* bottom = integral.ptr<int>(y2);
+
+        thresholdRowScalar(grey, binary, top, bottom, 0, interiorFrom, cols, radius, height, offset);
+        thresholdRowInterior(grey, binary, top, bottom, interiorFrom, interiorTo, radius, window * height, offset);
+        thresholdRowScalar(grey, binary, top, bottom, interiorTo, cols, cols, radius, height, offset);
+    }
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+
+// Adaptive binarization for unevenly lit scenes. A pixel is kept (like CV_THRESH_TOZERO)
+// if it is brighter than the mean of the window x window square around it by more than
+// offset, otherwise it becomes 0. Window means come from an integral image, so the cost
+// per pixel doesn't depend on the window size. Windows are clipped at the image border.
+void adaptiveThreshold(const cv::Mat& sceneGrey, cv::Mat& integral, cv::Mat& sceneBinary, int window, int offset);
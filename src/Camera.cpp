@@ -1,7 +1,9 @@
-
 #include "Camera.h"
 
 
+const int UNDISTORT_ITERATIONS = 10;
+
+
 cv::Mat getCameraMatrix(const Camera& c) {
     cv::Mat matrix = (cv::Mat_<double>(3, 3) <<
         c.focalX,   0.0,        c.principalX,
@@ -10,3 +12,64 @@ cv::Mat getCameraMatrix(const Camera& c) {
 
     return matrix;
 }
+
+
+cv::Mat getDistortionCoefficients(const Camera& c) {
+    return (cv::Mat_<double>(1, 5) << c.k1, c.k2, c.p1, c.p2, c.k3);
+}
+
+
+bool hasDistortion(const Camera& c) {
+    return c.k1 != 0.0 || c.k2 != 0.0 || c.p1 != 0.0 || c.p2 != 0.0 || c.k3 != 0.0;
+}
+
+
+// Lens model in normalized image coordinates
+cv::Point2d distortNormalized(const Camera& c, double x, double y) {
+    double r2 = x * x + y * y;
+    double radial = 1.0 + r2 * (c.k1 + r2 * (c.k2 + r2 * c.k3));
+
+    return{
+        x * radial + 2.0 * c.p1 * x * y + c.p2 * (r2 + 2.0 * x * x),
+        y * radial + c.p1 * (r2 + 2.0 * y * y) + 2.0 * c.p2 * x * y };
+}
+
+
+cv::Point2d distortPoint(const Camera& c, const cv::Point2d& point) {
+    double x = (point.x - c.principalX) / c.focalX;
+    double y = (point.y - c.principalY) / c.focalY;
+
+    cv::Point2d distorted = distortNormalized(c, x, y);
+
+    return{ distorted.x * c.focalX + c.principalX, distorted.y * c.focalY + c.principalY };
+}
+
+
+cv::Point2d undistortPoint(const Camera& c, const cv::Point2d& point) {
+    double xd = (point.x - c.principalX) / c.focalX;
+    double yd = (point.y - c.principalY) / c.focalY;
+    double x = xd, y = yd;
+
+    // Newton steps on distortNormalized(x, y) = (xd, yd), converging for strong distortion too
+    for (int i = 0; i < UNDISTORT_ITERATIONS; i++) {
+        double r2 = x * x + y * y;
+        double radial = 1.0 + r2 * (c.k1 + r2 * (c.k2 + r2 * c.k3));
+        double radialDr2 = c.k1 + r2 * (2.0 * c.k2 + r2 * 3.0 * c.k3);
+
+        double jxx = radial + 2.0 * x * x * radialDr2 + 2.0 * c.p1 * y + 6.0 * c.p2 * x;
+        double jxy = 2.0 * x * y * radialDr2 + 2.0 * c.p1 * x + 2.0 * c.p2 * y;
+        double jyy = radial + 2.0 * y * y * radialDr2 + 6.0 * c.p1 * y + 2.0 * c.p2 * x;
+
+        cv::Point2d distorted = distortNormalized(c, x, y);
+        double ex = distorted.x - xd, ey = distorted.y - yd;
+        double det = jxx * jyy - jxy * jxy;
+
+        if (det == 0.0)
+            break;
+
+        x -= (jyy * ex - jxy * ey) / det;
+        y -= (jxx * ey - jxy * ex) / det;
+    }
+
+    return{ x * c.focalX + c.principalX, y * c.focalY + c.principalY };
+}
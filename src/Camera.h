@@ -15,8 +15,27 @@ struct Camera {
     // focals in pixel units
     double focalX = 500.0;
     double focalY = 500.0;
+
+    // lens distortion in the OpenCV model, radial (k) and tangential (p)
+    double k1 = 0.0;
+    double k2 = 0.0;
+    double p1 = 0.0;
+    double p2 = 0.0;
+    double k3 = 0.0;
 };
 
 
 // Returns a 3x3 camera matrix of intrinsic parameters
 cv::Mat getCameraMatrix(const Camera& camera);
+
+// Returns the 1x5 distortion coefficients (k1, k2, p1, p2, k3)
+cv::Mat getDistortionCoefficients(const Camera& camera);
+
+// False for an ideal pinhole camera
+bool hasDistortion(const Camera& camera);
+
+// Pixel an ideal pinhole camera sees the point at moves to through the lens
+cv::Point2d distortPoint(const Camera& camera, const cv::Point2d& point);
+
+// Inverse of the above, iterative and exact enough to build lookup tables from
+cv::Point2d undistortPoint(const Camera& camera, const cv::Point2d& point);
@@ -0,0 +1,343 @@
+#include "Dataset.h"
+#include "SoftwareRendering.h"
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+// The records are written and mapped as they are in memory
+static_assert(std::is_standard_layout<DatasetHeader>::value && sizeof(DatasetHeader) == 152, "unexpected DatasetHeader layout");
+static_assert(std::is_standard_layout<DatasetFrame>::value && sizeof(DatasetFrame) == 16, "unexpected DatasetFrame layout");
+static_assert(std::is_standard_layout<DatasetMarker>::value && sizeof(DatasetMarker) == 56, "unexpected DatasetMarker layout");
+
+
+// The records are little-endian in the file and used in host byte order
+bool isLittleEndian() {
+    const std::uint32_t value = 1;
+    std::uint8_t firstByte;
+    std::memcpy(&firstByte, &value, 1);
+
+    return firstByte == 1;
+}
+
+
+std::uint64_t alignOffset(std::uint64_t offset, std::uint64_t alignment) {
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+
+// Zeros up to offset, the stream must not be past it
+bool padStream(std::ofstream& stream, std::uint64_t offset) {
+    static const char zeros[DATASET_ALIGNMENT] = {};
+    std::uint64_t position = std::uint64_t(stream.tellp());
+
+    assert(position <= offset);
+
+    while (position < offset) {
+        std::uint64_t count = std::min<std::uint64_t>(offset - position, sizeof(zeros));
+        stream.write(zeros, std::streamsize(count));
+        position += count;
+    }
+
+    return bool(stream);
+}
+
+
+bool writeDataset(const std::string& path, const Camera& camera, const std::vector<std::vector<Marker>>& frames,
+                  int textureSize) {
+    if (!isLittleEndian())
+        return false;
+
+    DatasetHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, DATASET_MAGIC, sizeof(header.magic));
+
+    header.version      = DATASET_VERSION;
+    header.headerSize   = sizeof(DatasetHeader);
+    header.width        = std::uint32_t(camera.imageWidth);
+    header.height       = std::uint32_t(camera.imageHeight);
+    header.format       = PIXEL_RGB;
+    header.numFrames    = std::uint32_t(frames.size());
+    header.stride       = std::uint64_t(camera.imageWidth) * 3;
+    header.frameSize    = header.stride * camera.imageHeight;
+    header.focalX       = camera.focalX;
+    header.focalY       = camera.focalY;
+    header.principalX   = camera.principalX;
+    header.principalY   = camera.principalY;
+
+    double distortion[5] = { camera.k1, camera.k2, camera.p1, camera.p2, camera.k3 };
+    std::memcpy(header.distortion, distortion, sizeof(distortion));
+
+    // the whole layout is known up front, so the file is written front to back
+    std::vector<DatasetFrame> index(frames.size());
+    std::vector<DatasetMarker> records;
+
+    header.indexOffset = alignOffset(sizeof(DatasetHeader), alignof(DatasetFrame));
+
+    for (std::size_t i = 0; i < frames.size(); i++) {
+        index[i].firstMarker = std::uint32_t(records.size());
+        index[i].numMarkers = std::uint32_t(frames[i].size());
+
+        for (const auto& marker : frames[i]) {
+            DatasetMarker record = {
+                { marker.t.x, marker.t.y, marker.t.z },
+                { marker.r.ox, marker.r.oy, marker.r.oz },
+                marker.id,
+                std::uint32_t(marker.numSquares)
+            };
+
+            records.push_back(record);
+        }
+    }
+
+    header.markersOffset = header.indexOffset + index.size() * sizeof(DatasetFrame);
+    header.numMarkers = records.size();
+
+    std::uint64_t offset = header.markersOffset + records.size() * sizeof(DatasetMarker);
+
+    for (auto& frame : index) {
+        frame.offset = alignOffset(offset, DATASET_ALIGNMENT);
+        offset = frame.offset + header.frameSize;
+    }
+
+    header.fileSize = offset;
+
+    std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+
+    if (!stream)
+        return false;
+
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    padStream(stream, header.indexOffset);
+    stream.write(reinterpret_cast<const char*>(index.data()), std::streamsize(index.size() * sizeof(DatasetFrame)));
+    stream.write(reinterpret_cast<const char*>(records.data()), std::streamsize(records.size() * sizeof(DatasetMarker)));
+
+    cv::Mat sceneRGB;
+
+    for (std::size_t i = 0; i < frames.size() && stream; i++) {
+        renderScene(camera, frames[i], textureSize, sceneRGB);
+        padStream(stream, index[i].offset);
+
+        for (int y = 0; y < sceneRGB.rows; y++) {
+            stream.write(sceneRGB.ptr<char>(y), std::streamsize(header.stride));
+        }
+    }
+
+    stream.close();
+    return bool(stream);
+}
+
+
+Dataset::Dataset() :
+    data(nullptr), bytes(0), header(nullptr), frames(nullptr), markers(nullptr)
+#ifdef _WIN32
+    , file(INVALID_HANDLE_VALUE), mapping(nullptr)
+#endif
+{
+}
+
+
+Dataset::~Dataset() {
+    close();
+}
+
+
+bool Dataset::open(const std::string& path) {
+    close();
+
+    if (!isLittleEndian())
+        return false;
+
+#ifdef _WIN32
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize;
+
+    if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) {
+        bytes = std::size_t(fileSize.QuadPart);
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    }
+
+    if (mapping) {
+        data = static_cast<const std::uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    }
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+
+    if (fd < 0)
+        return false;
+
+    struct stat status;
+
+    if (fstat(fd, &status) == 0 && status.st_size > 0) {
+        void* view = mmap(nullptr, std::size_t(status.st_size), PROT_READ, MAP_SHARED, fd, 0);
+
+        if (view != MAP_FAILED) {
+            data = static_cast<const std::uint8_t*>(view);
+            bytes = std::size_t(status.st_size);
+        }
+    }
+
+    // the mapping keeps the file alive
+    ::close(fd);
+#endif
+
+    if (!data || bytes < sizeof(DatasetHeader)) {
+        close();
+        return false;
+    }
+
+    header = reinterpret_cast<const DatasetHeader*>(data);
+
+    if (!isValid()) {
+        close();
+        return false;
+    }
+
+    frames = reinterpret_cast<const DatasetFrame*>(data + header->indexOffset);
+    markers = reinterpret_cast<const DatasetMarker*>(data + header->markersOffset);
+
+    camera = Camera();
+    camera.imageWidth   = int(header->width);
+    camera.imageHeight  = int(header->height);
+    camera.focalX       = header->focalX;
+    camera.focalY       = header->focalY;
+    camera.principalX   = header->principalX;
+    camera.principalY   = header->principalY;
+    camera.k1           = header->distortion[0];
+    camera.k2           = header->distortion[1];
+    camera.p1           = header->distortion[2];
+    camera.p2           = header->distortion[3];
+    camera.k3           = header->distortion[4];
+
+    return true;
+}
+
+
+void Dataset::close() {
+#ifdef _WIN32
+    if (data) {
+        UnmapViewOfFile(data);
+    }
+
+    if (mapping) {
+        CloseHandle(mapping);
+        mapping = nullptr;
+    }
+
+    if (file != INVALID_HANDLE_VALUE) {
+        CloseHandle(file);
+        file = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (data) {
+        munmap(const_cast<std::uint8_t*>(data), bytes);
+    }
+#endif
+
+    data = nullptr;
+    bytes = 0;
+    header = nullptr;
+    frames = nullptr;
+    markers = nullptr;
+}
+
+
+bool Dataset::isOpen() const {
+    return data != nullptr;
+}
+
+
+std::size_t Dataset::size() const {
+    return header ? header->numFrames : 0;
+}
+
+
+const Camera& Dataset::getCamera() const {
+    assert(isOpen());
+    return camera;
+}
+
+
+ImageBuffer Dataset::getFrame(std::size_t index) const {
+    assert(index < size());
+
+    ImageBuffer buffer;
+    buffer.data     = data + frames[index].offset;
+    buffer.width    = int(header->width);
+    buffer.height   = int(header->height);
+    buffer.stride   = std::size_t(header->stride);
+    buffer.format   = PixelFormat(header->format);
+
+    return buffer;
+}
+
+
+std::vector<Marker> Dataset::getMarkers(std::size_t index) const {
+    assert(index < size());
+
+    const DatasetFrame& frame = frames[index];
+    std::vector<Marker> result;
+    result.reserve(frame.numMarkers);
+
+    for (std::uint32_t i = 0; i < frame.numMarkers; i++) {
+        const DatasetMarker& record = markers[frame.firstMarker + i];
+
+        result.push_back(Marker(record.id,
+            Translation{ record.t[0], record.t[1], record.t[2] },
+            Rotation{ record.r[0], record.r[1], record.r[2] },
+            int(record.numSquares)));
+    }
+
+    return result;
+}
+
+
+// Every offset the accessors use has to lie within the mapping
+bool Dataset::isValid() const {
+    const DatasetHeader& h = *header;
+
+    if (std::memcmp(h.magic, DATASET_MAGIC, sizeof(h.magic)) != 0 ||
+        h.version != DATASET_VERSION || h.headerSize != sizeof(DatasetHeader) || h.fileSize != bytes)
+        return false;
+
+    // sizes and offsets are untrusted, so nothing below may overflow: products are
+    // bounded by a division first and sums are compared as differences
+    if (h.format != PIXEL_RGB || h.width == 0 || h.height == 0 || h.stride < std::uint64_t(h.width) * 3 ||
+        h.stride > bytes / h.height || h.frameSize != h.stride * h.height)
+        return false;
+
+    if (h.indexOffset % alignof(DatasetFrame) != 0 || h.markersOffset % alignof(DatasetMarker) != 0 ||
+        h.indexOffset < sizeof(DatasetHeader) || h.indexOffset > h.markersOffset || h.markersOffset > bytes)
+        return false;
+
+    if (h.numFrames > (h.markersOffset - h.indexOffset) / sizeof(DatasetFrame) ||
+        h.numMarkers > (bytes - h.markersOffset) / sizeof(DatasetMarker))
+        return false;
+
+    const DatasetFrame* index = reinterpret_cast<const DatasetFrame*>(data + h.indexOffset);
+
+    for (std::uint32_t i = 0; i < h.numFrames; i++) {
+        if (index[i].offset > bytes || h.frameSize > bytes - index[i].offset ||
+            std::uint64_t(index[i].firstMarker) + index[i].numMarkers > h.numMarkers)
+            return false;
+    }
+
+    return true;
+}
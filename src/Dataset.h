@@ -0,0 +1,119 @@
+#pragma once
+
+#include "Camera.h"
+#include "ImageBuffer.h"
+#include "Marker.h"
+
+#include <opencv2/opencv.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+// Rendered frames with their ground truth markers in one flat file meant to be mapped
+// into memory. All fields are little-endian and fixed-width, big-endian hosts can
+// neither write nor open datasets:
+//
+//   DatasetHeader                              at 0
+//   DatasetFrame[numFrames]                    at indexOffset
+//   DatasetMarker[numMarkers]                  at markersOffset, grouped by frame
+//   frame pixels, each DATASET_ALIGNMENT-aligned, RGB rows top-down without padding
+//
+// A mapped frame is an ImageBuffer straight away, nothing is decoded or copied.
+
+
+const char          DATASET_MAGIC[8]    = { 'M', 'P', 'D', 'A', 'T', 'A', 'S', 'T' };
+const std::uint32_t DATASET_VERSION     = 1;
+const std::uint64_t DATASET_ALIGNMENT   = 4096;     // page size, frames can be mapped on their own
+const int           DATASET_TEXTURE_SIZE = 256;     // renderScene() texture size
+
+
+struct DatasetHeader {
+    char            magic[8];
+    std::uint32_t   version;
+    std::uint32_t   headerSize;         // sizeof(DatasetHeader)
+    std::uint32_t   width;
+    std::uint32_t   height;
+    std::uint32_t   format;             // PixelFormat
+    std::uint32_t   numFrames;
+    std::uint64_t   stride;             // bytes per row
+    std::uint64_t   frameSize;          // bytes per frame, without the alignment padding
+    std::uint64_t   indexOffset;
+    std::uint64_t   markersOffset;
+    std::uint64_t   numMarkers;
+    std::uint64_t   fileSize;
+
+    // Camera the frames were rendered with
+    double          focalX;
+    double          focalY;
+    double          principalX;
+    double          principalY;
+    double          distortion[5];      // k1, k2, p1, p2, k3
+};
+
+
+struct DatasetFrame {
+    std::uint64_t   offset;             // of the pixels from the start of the file
+    std::uint32_t   firstMarker;        // index into the marker records
+    std::uint32_t   numMarkers;
+};
+
+
+// Marker in the OpenGL coordinates of Marker
+struct DatasetMarker {
+    double          t[3];
+    double          r[3];               // degrees around OX, OY, OZ
+    std::uint32_t   id;
+    std::uint32_t   numSquares;
+};
+
+
+// Render every frame with renderScene() and write it, together with its markers, to path.
+// Frames are rendered and written one at a time. Returns false if the file can't be written
+// or the host is big-endian.
+bool writeDataset(const std::string& path, const Camera& camera, const std::vector<std::vector<Marker>>& frames,
+                  int textureSize = DATASET_TEXTURE_SIZE);
+
+
+// Read-only mapping of a file made by writeDataset(). Frames are handed out as pointers
+// into the mapping and are valid until close(). Not copyable.
+class Dataset {
+public:
+    Dataset();
+    ~Dataset();
+
+    Dataset(const Dataset&) = delete;
+    Dataset& operator=(const Dataset&) = delete;
+
+    // False if the file can't be mapped, is not a valid dataset or the host is big-endian
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen() const;
+
+    std::size_t size() const;
+
+    const Camera& getCamera() const;
+
+    // Pixels of a frame in the mapping, see wrapImageBuffer() for a cv::Mat
+    ImageBuffer getFrame(std::size_t index) const;
+
+    // Ground truth markers of a frame
+    std::vector<Marker> getMarkers(std::size_t index) const;
+
+private:
+    bool isValid() const;
+
+    const std::uint8_t*     data;
+    std::size_t             bytes;
+    const DatasetHeader*    header;
+    const DatasetFrame*     frames;
+    const DatasetMarker*    markers;
+    Camera                  camera;
+
+#ifdef _WIN32
+    void*                   file;
+    void*                   mapping;
+#endif
+};
@@ -0,0 +1,323 @@
+#include "Decoding.h"
+#include "RecognitionStages.h"
+#include "MarkerLayout.h"
+#include "Marker.h"
+
+#include <opencv2/opencv.hpp>
+#include <cassert>
+
+
+const double BIT_THRESHOLD = 127.0;     // grey value separating black and white squares
+const double SCORE_EPSILON = 1e-9;      // a larger grid has to score better by more than this
+const int    TURN_ANGLES[4] = { 0, 90, 180, -90 };  // rotateQuad() angle of n clockwise turns
+
+
+// Mean value of a rect given an integral image
+double rectMean(const cv::Mat& integral, const LayoutRect& rect) {
+    const int* top = integral.ptr<int>(rect.y);
+    const int* bottom = integral.ptr<int>(rect.y + rect.height);
+
+    int x1 = rect.x, x2 = rect.x + rect.width;
+    int sum = bottom[x2] - bottom[x1] - top[x2] + top[x1];
+
+    return double(sum) / rect.area();
+}
+
+
+void integrateMarkerImage(MarkerCandidate& candidate) {
+    assert(candidate.image.type() == CV_8UC1);
+    cv::integral(candidate.image, candidate.integral, CV_32S);
+}
+
+
+void integrateMarkerImages(CandidateList& candidates) {
+    for (std::size_t i = 0; i < candidates.size(); i++) {
+        integrateMarkerImage(candidates[i]);
+    }
+}
+
+
+template <typename Layout>
+void computeMarkerCells(const cv::Mat& integral, MarkerCells& cells) {
+    assert(integral.type() == CV_32SC1);
+    assert(integral.cols == Layout::SIZE_PX + 1 && integral.rows == Layout::SIZE_PX + 1);
+
+    for (int i = 0; i < 4; i++) {
+        cells.frame[i] = rectMean(integral, Layout::FRAME[i]);
+    }
+
+    for (int i = 0; i < Layout::NUM_FIELDS; i++) {
+        cells.squares[i] = rectMean(integral, Layout::SQUARES[i]);
+    }
+}
+
+
+// Mean of samplesPerSide^2 nearest-neighbour samples of a normalized marker rect.
+// Sample points outside of the scene are black, like warpPerspective() borders.
+// With a lens, h maps onto undistorted pixels and every sample point gets distorted.
+double sampleRect(const cv::Mat& sceneGrey, const cv::Matx33d& h, const LayoutRect& rect, int samplesPerSide, const Camera* lens) {
+    double stepX = double(rect.width) / samplesPerSide;
+    double stepY = double(rect.height) / samplesPerSide;
+    int sum = 0;
+
+    for (int j = 0; j < samplesPerSide; j++) {
+        // pixel centers are at integer coordinates
+        double v = rect.y + (j + 0.5) * stepY - 0.5;
+
+        for (int i = 0; i < samplesPerSide; i++) {
+            double u = rect.x + (i + 0.5) * stepX - 0.5;
+
+            double w = h(2, 0) * u + h(2, 1) * v + h(2, 2);
+            cv::Point2d point{ (h(0, 0) * u + h(0, 1) * v + h(0, 2)) / w, (h(1, 0) * u + h(1, 1) * v + h(1, 2)) / w };
+
+            if (lens) {
+                point = distortPoint(*lens, point);
+            }
+
+            int x = cvRound(point.x);
+            int y = cvRound(point.y);
+
+            if (x >= 0 && y >= 0 && x < sceneGrey.cols && y < sceneGrey.rows) {
+                sum += sceneGrey.ptr<uchar>(y)[x];
+            }
+        }
+    }
+
+    return double(sum) / (samplesPerSide * samplesPerSide);
+}
+
+
+template <typename Layout>
+void sampleMarkerCells(const cv::Mat& sceneGrey, const cv::Matx33d& markerToScene, int samplesPerSide, MarkerCells& cells,
+                       const Camera* lens) {
+    assert(sceneGrey.type() == CV_8UC1);
+    assert(samplesPerSide > 0);
+
+    for (int i = 0; i < 4; i++) {
+        cells.frame[i] = sampleRect(sceneGrey, markerToScene, Layout::FRAME[i], samplesPerSide, lens);
+    }
+
+    for (int i = 0; i < Layout::NUM_FIELDS; i++) {
+        cells.squares[i] = sampleRect(sceneGrey, markerToScene, Layout::SQUARES[i], samplesPerSide, lens);
+    }
+}
+
+
+template <typename Layout>
+std::uint64_t getCellBits(const MarkerCells& cells) {
+    std::uint64_t bits = 0;
+
+    for (int i = 0; i < Layout::NUM_FIELDS; i++) {
+        std::uint64_t bitValue = cells.squares[i] < BIT_THRESHOLD ? 0u : 1u;
+        bits |= bitValue << i;
+    }
+
+    return bits;
+}
+
+
+template <typename Layout>
+int getMarkerTurns(std::uint64_t bits) {
+    std::uint64_t corners = bits & Layout::CORNER_BITS;
+
+    for (int turns = 0; turns < 4; turns++) {
+        std::uint64_t black = std::uint64_t(1) << Layout::TURNED_BLACK_CORNER_IDS[turns];
+
+        if (corners == (Layout::CORNER_BITS & ~black))
+            return turns;
+    }
+
+    return -1;
+}
+
+
+template <typename Layout>
+bool isMarkerValid(const MarkerCells& cells, int turns, double tolerance) {
+    assert(turns >= 0 && turns < 4);
+
+    double highValue = (1.0 - tolerance) * 255.0;
+    double lowValue = tolerance * 255.0;
+    int blackCorner = Layout::TURNED_BLACK_CORNER_IDS[turns];
+
+    double frame = (cells.frame[0] + cells.frame[1] + cells.frame[2] + cells.frame[3]) / 4.0;
+
+    if (frame <= highValue)
+        return false;
+
+    for (int cornerId : Layout::CORNER_IDS) {
+        double color = cells.squares[cornerId];
+
+        if (cornerId == blackCorner ? color > lowValue : color < highValue)
+            return false;
+    }
+
+    return true;
+}
+
+
+// Byte-wise tables gathering the id bits of a cell bit word, one set per rotation.
+// Built on first use, read-only afterwards.
+template <int N>
+struct IdLookup {
+    typedef MarkerGrid<N> Grid;
+
+    static constexpr int NUM_BYTES = (Grid::NUM_FIELDS + 7) / 8;
+
+    std::uint32_t table[4][NUM_BYTES][256];
+
+    IdLookup() : table() {
+        for (int turns = 0; turns < 4; turns++) {
+            for (int bitIndex = 0; bitIndex < Grid::NUM_BITS; bitIndex++) {
+                int squareId = Grid::TURNED_BIT_SQUARE_IDS[turns][bitIndex];
+                auto& bytes = table[turns][squareId / 8];
+
+                for (int value = 0; value < 256; value++) {
+                    if (value & (1 << (squareId % 8))) {
+                        bytes[value] |= 1u << bitIndex;
+                    }
+                }
+            }
+        }
+    }
+
+    static const IdLookup& get() {
+        static const IdLookup lookup;
+        return lookup;
+    }
+};
+
+
+template <typename Layout>
+std::uint32_t getId(std::uint64_t bits, int turns) {
+    typedef IdLookup<Layout::NUM_SQUARES> Lookup;
+
+    assert(turns >= 0 && turns < 4);
+
+    const auto& table = Lookup::get().table[turns];
+    std::uint32_t id = 0;
+
+    for (int i = 0; i < Lookup::NUM_BYTES; i++) {
+        id |= table[i][(bits >> (8 * i)) & 0xff];
+    }
+
+    return id;
+}
+
+
+template <typename Layout>
+double calculateScore(const MarkerCells& cells, std::uint64_t bits) {
+    const double squareArea = Layout::SQUARE_PX * Layout::SQUARE_PX;
+    double totalSum = 0.0;
+    double totalArea = Layout::NUM_FIELDS * squareArea;
+
+    // all frame elements
+    for (int i = 0; i < 4; i++) {
+        totalSum += cells.frame[i] * Layout::FRAME[i].area();
+        totalArea += Layout::FRAME[i].area();
+    }
+
+    // corners and id squares alike, a valid marker has the white ones set
+    for (int i = 0; i < Layout::NUM_FIELDS; i++) {
+        double mean = cells.squares[i];
+
+        // the square could be white or black
+        totalSum += (bits & (std::uint64_t(1) << i)) ? mean * squareArea : (255.0 - mean) * squareArea;
+    }
+
+    // the squares of some grid sizes don't tile the whole image, only the covered area
+    // counts, so a perfect marker scores 1.0 with every grid
+    return totalSum / totalArea / 255.0;
+}
+
+
+// Whole decoding of one candidate for an N*N grid. Called once per candidate
+// and grid size, so every per-field loop below has a compile-time trip count.
+template <int N>
+struct DecodeCandidate {
+    typedef NormalizedLayout<N> Layout;
+
+    // Returns false if the candidate is not a valid N*N marker
+    static bool run(const MarkerCandidate& candidate, const cv::Mat& sceneGrey, const cv::Matx33d& markerToScene,
+                    const DetectorParams& params, double tolerance, const Camera* lens, MarkerDecoding& decoding) {
+
+        if (params.decodeMode == DECODE_WARP) {
+            computeMarkerCells<Layout>(candidate.integral, decoding.cells);
+        }
+        else {
+            sampleMarkerCells<Layout>(sceneGrey, markerToScene, params.samplesPerSide, decoding.cells, lens);
+        }
+
+        // the cells are read once, only the quad gets rotated
+        decoding.bits = getCellBits<Layout>(decoding.cells);
+        int turns = getMarkerTurns<Layout>(decoding.bits);
+
+        if (turns < 0 || !isMarkerValid<Layout>(decoding.cells, turns, tolerance))
+            return false;
+
+        decoding.rotation = TURN_ANGLES[turns];
+        decoding.numSquares = N;
+        decoding.id = getId<Layout>(decoding.bits, turns);
+        decoding.score = calculateScore<Layout>(decoding.cells, decoding.bits);
+
+        return true;
+    }
+};
+
+
+bool decodeMarkerCandidate(const cv::Mat& sceneGrey, MarkerCandidate& candidate, const DetectorParams& params, double tolerance,
+                           const Camera* lens) {
+    MarkerDecoding decoding;
+    cv::Matx33d markerToScene;
+    auto& best = candidate.decoding;
+
+    best.numSquares = 0;
+
+    if (params.decodeMode == DECODE_SAMPLE) {
+        markerToScene = get2DPerspectiveTransform(candidate.quad, NORMALIZED_MARKER_SIZE);
+    }
+
+    // grid sizes are ascending, a marker with an N*N grid is also a valid 2N*2N
+    // marker with the same score, so the smaller grid wins ties
+    for (int numSquares : params.gridSizes) {
+        bool valid = dispatchGridSize<DecodeCandidate>(numSquares,
+            candidate, sceneGrey, markerToScene, params, tolerance, lens, decoding);
+
+        if (valid && (best.numSquares == 0 || decoding.score > best.score + SCORE_EPSILON)) {
+            best = decoding;
+        }
+    }
+
+    if (best.numSquares == 0)
+        return false;
+
+    rotateQuad(candidate.quad, best.rotation);
+    return true;
+}
+
+
+void decodeMarkerCandidates(const cv::Mat& sceneGrey, CandidateList& candidates, const DetectorParams& params, double tolerance) {
+    for (std::size_t i = 0; i < candidates.size(); i++) {
+        decodeMarkerCandidate(sceneGrey, candidates[i], params, tolerance);
+    }
+
+    candidates.filter([](const MarkerCandidate& candidate) {
+        return candidate.decoding.numSquares != 0;
+    });
+}
+
+
+// Explicit instantiations
+#define INSTANTIATE_DECODING(N) \
+    template void computeMarkerCells<NormalizedLayout<N>>(const cv::Mat&, MarkerCells&); \
+    template void sampleMarkerCells<NormalizedLayout<N>>(const cv::Mat&, const cv::Matx33d&, int, MarkerCells&, const Camera*); \
+    template std::uint64_t getCellBits<NormalizedLayout<N>>(const MarkerCells&); \
+    template int  getMarkerTurns<NormalizedLayout<N>>(std::uint64_t); \
+    template bool isMarkerValid<NormalizedLayout<N>>(const MarkerCells&, int, double); \
+    template std::uint32_t getId<NormalizedLayout<N>>(std::uint64_t, int); \
+    template double calculateScore<NormalizedLayout<N>>(const MarkerCells&, std::uint64_t);
+
+INSTANTIATE_DECODING(2)
+INSTANTIATE_DECODING(3)
+INSTANTIATE_DECODING(4)
+INSTANTIATE_DECODING(5)
+INSTANTIATE_DECODING(6)
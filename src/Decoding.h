@@ -0,0 +1,63 @@
+#pragma once
+
+#include "RecognitionStages.h"
+#include "Recognition.h"
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+
+
+// Decoding a marker from the mean values of its fields. The values come either
+// from an integral image of the warped marker or from sampling the scene directly.
+// Layout is a MarkerLayout<N, SizePx>, the functions are instantiated for
+// NormalizedLayout<N> of every supported grid size.
+
+
+// Integral image of a warped candidate, shared by all grid sizes
+void integrateMarkerImage(MarkerCandidate& candidate);
+
+// Integral images of every warped candidate
+void integrateMarkerImages(CandidateList& candidates);
+
+// Decode a candidate with each of params.gridSizes and keep the best scoring
+// valid decoding. Returns false if there is none, otherwise the quad is rotated upright.
+// A lens means the quad is undistorted, DECODE_SAMPLE then distorts its sample points.
+bool decodeMarkerCandidate(const cv::Mat& sceneGrey, MarkerCandidate& candidate, const DetectorParams& params, double tolerance,
+                           const Camera* lens = nullptr);
+
+// Decode every candidate and remove those without a valid decoding
+void decodeMarkerCandidates(const cv::Mat& sceneGrey, CandidateList& candidates, const DetectorParams& params, double tolerance);
+
+// Field means of a normalized marker image given its integral image,
+// every field is summed in O(1)
+template <typename Layout>
+void computeMarkerCells(const cv::Mat& integral, MarkerCells& cells);
+
+// Samples the fields straight from the scene through the normalized marker -> scene
+// homography. Each field is averaged over samplesPerSide^2 evenly spread points.
+// With a lens the homography maps onto undistorted pixels, see decodeMarkerCandidate().
+template <typename Layout>
+void sampleMarkerCells(const cv::Mat& sceneGrey, const cv::Matx33d& markerToScene, int samplesPerSide, MarkerCells& cells,
+                       const Camera* lens = nullptr);
+
+// One bit per square, set if its mean is white (row-major, LSB first)
+template <typename Layout>
+std::uint64_t getCellBits(const MarkerCells& cells);
+
+// Number of 90 degree clockwise turns making the grid upright,
+// -1 unless exactly one corner of the bits is black
+template <typename Layout>
+int getMarkerTurns(std::uint64_t bits);
+
+// Check the white frame and the 3 white + 1 black corners of a grid needing turns to be upright
+template <typename Layout>
+bool isMarkerValid(const MarkerCells& cells, int turns, double tolerance);
+
+// Calculate marker ID from the bits of a grid needing turns to be upright,
+// a few table lookups per word
+template <typename Layout>
+std::uint32_t getId(std::uint64_t bits, int turns);
+
+// Calculate marker recognition score given its bits, doesn't depend on the rotation
+template <typename Layout>
+double calculateScore(const MarkerCells& cells, std::uint64_t bits);
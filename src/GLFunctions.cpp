@@ -0,0 +1,44 @@
+#include "GLFunctions.h"
+
+#include <GL/freeglut.h>
+
+
+template <typename Function>
+Function loadFunction(const char* name) {
+    return reinterpret_cast<Function>(glutGetProcAddress(name));
+}
+
+
+bool GLFunctions::hasBuffers() const {
+    return genBuffers && deleteBuffers && bindBuffer && bufferData && mapBuffer && unmapBuffer;
+}
+
+
+bool GLFunctions::hasFramebuffers() const {
+    return genFramebuffers && deleteFramebuffers && bindFramebuffer &&
+        genRenderbuffers && deleteRenderbuffers && bindRenderbuffer &&
+        renderbufferStorage && framebufferRenderbuffer && checkFramebufferStatus;
+}
+
+
+const GLFunctions& getGLFunctions() {
+    static const GLFunctions functions = {
+        loadFunction<GLFunctions::GenObjects>("glGenBuffers"),
+        loadFunction<GLFunctions::DeleteObjects>("glDeleteBuffers"),
+        loadFunction<GLFunctions::BindObject>("glBindBuffer"),
+        loadFunction<GLFunctions::BufferData>("glBufferData"),
+        loadFunction<GLFunctions::MapBuffer>("glMapBuffer"),
+        loadFunction<GLFunctions::UnmapBuffer>("glUnmapBuffer"),
+
+        loadFunction<GLFunctions::GenObjects>("glGenFramebuffers"),
+        loadFunction<GLFunctions::DeleteObjects>("glDeleteFramebuffers"),
+        loadFunction<GLFunctions::BindObject>("glBindFramebuffer"),
+        loadFunction<GLFunctions::GenObjects>("glGenRenderbuffers"),
+        loadFunction<GLFunctions::DeleteObjects>("glDeleteRenderbuffers"),
+        loadFunction<GLFunctions::BindObject>("glBindRenderbuffer"),
+        loadFunction<GLFunctions::RenderbufferStorage>("glRenderbufferStorage"),
+        loadFunction<GLFunctions::FramebufferRenderbuffer>("glFramebufferRenderbuffer"),
+        loadFunction<GLFunctions::CheckFramebufferStatus>("glCheckFramebufferStatus") };
+
+    return functions;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#include <GL/GL.h>
+#include <cstddef>
+
+
+// Entry points above OpenGL 1.1 (buffer objects from 2.1, framebuffer objects from 3.0),
+// loaded at runtime as not every platform's GL library exports them
+
+
+#ifndef GL_ARRAY_BUFFER
+#define GL_ARRAY_BUFFER             0x8892
+#endif
+#ifndef GL_PIXEL_PACK_BUFFER
+#define GL_PIXEL_PACK_BUFFER        0x88EB
+#endif
+#ifndef GL_STREAM_DRAW
+#define GL_STREAM_DRAW              0x88E0
+#endif
+#ifndef GL_STREAM_READ
+#define GL_STREAM_READ              0x88E1
+#endif
+#ifndef GL_READ_ONLY
+#define GL_READ_ONLY                0x88B8
+#endif
+#ifndef GL_FRAMEBUFFER
+#define GL_FRAMEBUFFER              0x8D40
+#endif
+#ifndef GL_RENDERBUFFER
+#define GL_RENDERBUFFER             0x8D41
+#endif
+#ifndef GL_COLOR_ATTACHMENT0
+#define GL_COLOR_ATTACHMENT0        0x8CE0
+#endif
+#ifndef GL_DEPTH_ATTACHMENT
+#define GL_DEPTH_ATTACHMENT         0x8D00
+#endif
+#ifndef GL_FRAMEBUFFER_COMPLETE
+#define GL_FRAMEBUFFER_COMPLETE     0x8CD5
+#endif
+#ifndef GL_DEPTH_COMPONENT24
+#define GL_DEPTH_COMPONENT24        0x81A6
+#endif
+
+
+struct GLFunctions {
+    typedef void      (APIENTRY* GenObjects)(GLsizei n, GLuint* objects);
+    typedef void      (APIENTRY* DeleteObjects)(GLsizei n, const GLuint* objects);
+    typedef void      (APIENTRY* BindObject)(GLenum target, GLuint object);
+    typedef void      (APIENTRY* BufferData)(GLenum target, std::ptrdiff_t size, const void* data, GLenum usage);
+    typedef void*     (APIENTRY* MapBuffer)(GLenum target, GLenum access);
+    typedef GLboolean (APIENTRY* UnmapBuffer)(GLenum target);
+    typedef void      (APIENTRY* RenderbufferStorage)(GLenum target, GLenum format, GLsizei width, GLsizei height);
+    typedef void      (APIENTRY* FramebufferRenderbuffer)(GLenum target, GLenum attachment, GLenum renderbufferTarget, GLuint renderbuffer);
+    typedef GLenum    (APIENTRY* CheckFramebufferStatus)(GLenum target);
+
+    // buffer objects
+    GenObjects              genBuffers;
+    DeleteObjects           deleteBuffers;
+    BindObject              bindBuffer;
+    BufferData              bufferData;
+    MapBuffer               mapBuffer;
+    UnmapBuffer             unmapBuffer;
+
+    // framebuffer objects
+    GenObjects              genFramebuffers;
+    DeleteObjects           deleteFramebuffers;
+    BindObject              bindFramebuffer;
+    GenObjects              genRenderbuffers;
+    DeleteObjects           deleteRenderbuffers;
+    BindObject              bindRenderbuffer;
+    RenderbufferStorage     renderbufferStorage;
+    FramebufferRenderbuffer framebufferRenderbuffer;
+    CheckFramebufferStatus  checkFramebufferStatus;
+
+    bool hasBuffers() const;
+    bool hasFramebuffers() const;
+};
+
+
+// Entry points of the current context, loaded on first use. A GLUT window (hidden or not)
+// has to exist before, the pointers are shared by every context afterwards.
+const GLFunctions& getGLFunctions();
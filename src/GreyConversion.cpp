@@ -0,0 +1,240 @@
+#include "GreyConversion.h"
+
+#include <opencv2/opencv.hpp>
+#include <cassert>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GREY_CONVERSION_X86
+#include <immintrin.h>
+#endif
+
+
+// cv::cvtColor() fixed point weights of the OpenCV version built against,
+// 14 fractional bits up to OpenCV 3 (2.x defines CV_VERSION_EPOCH), 15 since 4
+#if defined(CV_VERSION_EPOCH) || CV_VERSION_MAJOR < 4
+const int GREY_SHIFT    = 14;
+const int GREY_R        = 4899;
+const int GREY_G        = 9617;
+const int GREY_B        = 1868;
+#else
+const int GREY_SHIFT    = 15;
+const int GREY_R        = 9798;
+const int GREY_G        = 19235;
+const int GREY_B        = 3735;
+#endif
+const int GREY_ROUND    = 1 << (GREY_SHIFT - 1);
+
+
+typedef void (*GreyRowKernel)(const uchar* rgb, uchar* grey, uchar* binary, int width, int threshold);
+
+
+// Pixels [from, width) of a row
+void convertRowScalar(const uchar* rgb, uchar* grey, uchar* binary, int from, int width, int threshold) {
+    for (int x = from; x < width; x++) {
+        const uchar* pixel = rgb + 3 * x;
+
+        int value = (pixel[0] * GREY_R + pixel[1] * GREY_G + pixel[2] * GREY_B + GREY_ROUND) >> GREY_SHIFT;
+
+        grey[x] = uchar(value);
+        binary[x] = value > threshold ? uchar(value) : 0;
+    }
+}
+
+
+void convertRowScalar(const uchar* rgb, uchar* grey, uchar* binary, int width, int threshold) {
+    convertRowScalar(rgb, grey, binary, 0, width, threshold);
+}
+
+
+#ifdef GREY_CONVERSION_X86
+
+// Both kernels work on groups of 4 pixels (12 bytes, read with a 16 byte load).
+// pshufb spreads a group into 16-bit R,G pairs and B,1 pairs, pmaddwd then yields
+// R*wr + G*wg and B*wb + round as 32-bit sums.
+#define RG_SHUFFLE  0, -1, 1, -1, 3, -1, 4, -1, 6, -1, 7, -1, 9, -1, 10, -1
+#define B_SHUFFLE   2, -1, -1, -1, 5, -1, -1, -1, 8, -1, -1, -1, 11, -1, -1, -1
+
+
+// Grey values of the 4 pixels at src as 32-bit integers
+__attribute__((target("sse4.1")))
+inline __m128i greyGroupSSE41(const uchar* src) {
+    const __m128i rgShuffle = _mm_setr_epi8(RG_SHUFFLE);
+    const __m128i bShuffle  = _mm_setr_epi8(B_SHUFFLE);
+    const __m128i one       = _mm_set1_epi32(1 << 16);
+    const __m128i rgWeights = _mm_set1_epi32((GREY_G << 16) | GREY_R);
+    const __m128i bWeights  = _mm_set1_epi32((GREY_ROUND << 16) | GREY_B);
+
+    __m128i v  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+    __m128i rg = _mm_shuffle_epi8(v, rgShuffle);
+    __m128i b1 = _mm_or_si128(_mm_shuffle_epi8(v, bShuffle), one);
+    __m128i sum = _mm_add_epi32(_mm_madd_epi16(rg, rgWeights), _mm_madd_epi16(b1, bWeights));
+
+    return _mm_srli_epi32(sum, GREY_SHIFT);
+}
+
+
+__attribute__((target("sse4.1")))
+void convertRowSSE41(const uchar* rgb, uchar* grey, uchar* binary, int width, int threshold) {
+    const __m128i signBit   = _mm_set1_epi8(char(0x80));
+    const __m128i limit     = _mm_set1_epi8(char(threshold ^ 0x80));
+
+    int x = 0;
+
+    // the last load reads 4 bytes past the 16th pixel
+    for (; x + 18 <= width; x += 16) {
+        const uchar* src = rgb + 3 * x;
+
+        __m128i lo = _mm_packus_epi32(greyGroupSSE41(src), greyGroupSSE41(src + 12));
+        __m128i hi = _mm_packus_epi32(greyGroupSSE41(src + 24), greyGroupSSE41(src + 36));
+        __m128i g  = _mm_packus_epi16(lo, hi);
+
+        // unsigned g > threshold
+        __m128i mask = _mm_cmpgt_epi8(_mm_xor_si128(g, signBit), limit);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(grey + x), g);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(binary + x), _mm_and_si128(g, mask));
+    }
+
+    convertRowScalar(rgb, grey, binary, x, width, threshold);
+}
+
+
+// Group k of src in the low lane, group k + 4 in the high one, so that
+// the in-lane packs of convertRowAVX2() put all 32 pixels in order
+__attribute__((target("avx2")))
+inline __m256i greyGroupsAVX2(const uchar* src, int k) {
+    const __m256i rgShuffle = _mm256_setr_epi8(RG_SHUFFLE, RG_SHUFFLE);
+    const __m256i bShuffle  = _mm256_setr_epi8(B_SHUFFLE, B_SHUFFLE);
+    const __m256i one       = _mm256_set1_epi32(1 << 16);
+    const __m256i rgWeights = _mm256_set1_epi32((GREY_G << 16) | GREY_R);
+    const __m256i bWeights  = _mm256_set1_epi32((GREY_ROUND << 16) | GREY_B);
+
+    __m128i low  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 12 * k));
+    __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 12 * (k + 4)));
+    __m256i v  = _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+    __m256i rg = _mm256_shuffle_epi8(v, rgShuffle);
+    __m256i b1 = _mm256_or_si256(_mm256_shuffle_epi8(v, bShuffle), one);
+    __m256i sum = _mm256_add_epi32(_mm256_madd_epi16(rg, rgWeights), _mm256_madd_epi16(b1, bWeights));
+
+    return _mm256_srli_epi32(sum, GREY_SHIFT);
+}
+
+
+__attribute__((target("avx2")))
+void convertRowAVX2(const uchar* rgb, uchar* grey, uchar* binary, int width, int threshold) {
+    const __m256i signBit   = _mm256_set1_epi8(char(0x80));
+    const __m256i limit     = _mm256_set1_epi8(char(threshold ^ 0x80));
+
+    int x = 0;
+
+    // the last load reads 4 bytes past the 32nd pixel
+    for (; x + 34 <= width; x += 32) {
+        const uchar* src = rgb + 3 * x;
+
+        __m256i lo = _mm256_packus_epi32(greyGroupsAVX2(src, 0), greyGroupsAVX2(src, 1));
+        __m256i hi = _mm256_packus_epi32(greyGroupsAVX2(src, 2), greyGroupsAVX2(src, 3));
+        __m256i g  = _mm256_packus_epi16(lo, hi);
+
+        __m256i mask = _mm256_cmpgt_epi8(_mm256_xor_si256(g, signBit), limit);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(grey + x), g);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(binary + x), _mm256_and_si256(g, mask));
+    }
+
+    convertRowSSE41(rgb + 3 * x, grey + x, binary + x, width - x, threshold);
+}
+
+#endif
+
+
+struct GreyKernel {
+    GreyRowKernel   row;
+    const char*     name;
+};
+
+
+GreyKernel selectGreyKernel() {
+#ifdef GREY_CONVERSION_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2"))
+        return{ convertRowAVX2, "avx2" };
+
+    if (__builtin_cpu_supports("sse4.1"))
+        return{ convertRowSSE41, "sse4.1" };
+#endif
+
+    return{ convertRowScalar, "scalar" };
+}
+
+
+const GreyKernel& getGreyKernel() {
+    static const GreyKernel kernel = selectGreyKernel();
+    return kernel;
+}
+
+
+const char* getGreyKernelName() {
+    return getGreyKernel().name;
+}
+
+
+void convertToGreyAndBinary(const cv::Mat& sceneRGB, cv::Mat& sceneGrey, cv::Mat& sceneBinary, int threshold,
+                            bool bottomUp) {
+    assert(sceneRGB.type() == CV_8UC3);
+    assert(threshold >= 0 && threshold <= 255);
+
+    sceneGrey.create(sceneRGB.size(), CV_8UC1);
+    sceneBinary.create(sceneRGB.size(), CV_8UC1);
+
+    auto row = getGreyKernel().row;
+
+    for (int y = 0; y < sceneRGB.rows; y++) {
+        int source = bottomUp ? sceneRGB.rows - 1 - y : y;
+        row(sceneRGB.ptr<uchar>(source), sceneGrey.ptr<uchar>(y), sceneBinary.ptr<uchar>(y), sceneRGB.cols, threshold);
+    }
+}
+
+
+// Grey conversion of a scene in a format without a luma plane, one row at a time if bottomUp
+void convertRows(const cv::Mat& scene, PixelFormat format, bool bottomUp, cv::Mat& grey) {
+    auto convert = [format](const cv::Mat& src, cv::Mat& dst) {
+        if (format == PIXEL_YUYV) {
+            cv::extractChannel(src, dst, 0);
+        }
+        else {
+            cv::cvtColor(src, dst, format == PIXEL_RGB ? CV_RGB2GRAY : CV_BGR2GRAY);
+        }
+    };
+
+    if (!bottomUp) {
+        convert(scene, grey);
+        return;
+    }
+
+    grey.create(scene.size(), CV_8UC1);
+
+    for (int y = 0; y < scene.rows; y++) {
+        cv::Mat dst = grey.row(y);
+        convert(scene.row(scene.rows - 1 - y), dst);
+    }
+}
+
+
+void getGreyImage(const cv::Mat& scene, PixelFormat format, bool bottomUp, cv::Mat& greyBuffer, cv::Mat& sceneGrey) {
+    assert(scene.type() == getPixelType(format));
+
+    if (hasLumaPlane(format) && !bottomUp) {
+        sceneGrey = scene;
+        return;
+    }
+
+    if (hasLumaPlane(format)) {
+        cv::flip(scene, greyBuffer, 0);
+    }
+    else {
+        convertRows(scene, format, bottomUp, greyBuffer);
+    }
+
+    sceneGrey = greyBuffer;
+}
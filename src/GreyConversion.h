@@ -0,0 +1,23 @@
+#pragma once
+
+#include "ImageBuffer.h"
+
+#include <opencv2/opencv.hpp>
+
+
+// RGB -> grey conversion fused with binarization. One pass over the packed RGB frame
+// writes both the grey image (for corner refinement and decoding) and the binary one
+// (for contour tracing). Grey values match cv::cvtColor(CV_RGB2GRAY) of the OpenCV
+// version built against (its fixed point weights changed in OpenCV 4), binary values
+// match cv::threshold(CV_THRESH_TOZERO). The kernel (AVX2, SSE4.1 or scalar)
+// is picked at runtime from the CPU features. A bottomUp frame comes out top-down.
+void convertToGreyAndBinary(const cv::Mat& sceneRGB, cv::Mat& sceneGrey, cv::Mat& sceneBinary, int threshold,
+                            bool bottomUp = false);
+
+// Name of the kernel used by convertToGreyAndBinary()
+const char* getGreyKernelName();
+
+// Top-down grey image of a scene wrapped by wrapImageBuffer(), or of a region of it. Formats
+// with a luma plane share it without copying, the others are converted into greyBuffer.
+// The rows of a bottomUp scene are reversed within the conversion, its luma plane is copied.
+void getGreyImage(const cv::Mat& scene, PixelFormat format, bool bottomUp, cv::Mat& greyBuffer, cv::Mat& sceneGrey);
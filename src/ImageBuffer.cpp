@@ -0,0 +1,39 @@
+#include "ImageBuffer.h"
+
+#include <cassert>
+
+
+int getPixelType(PixelFormat format) {
+    switch (format) {
+    case PIXEL_GRAY8:
+    case PIXEL_NV12:
+        return CV_8UC1;
+    case PIXEL_RGB:
+    case PIXEL_BGR:
+        return CV_8UC3;
+    case PIXEL_YUYV:
+        return CV_8UC2;
+    }
+
+    assert(false && "Unknown pixel format");
+    return CV_8UC1;
+}
+
+
+bool hasLumaPlane(PixelFormat format) {
+    return format == PIXEL_GRAY8 || format == PIXEL_NV12;
+}
+
+
+cv::Mat wrapImageBuffer(const ImageBuffer& buffer) {
+    assert(buffer.data != nullptr);
+    assert(buffer.width > 0 && buffer.height > 0);
+    assert(buffer.format != PIXEL_YUYV || buffer.width % 2 == 0);
+    assert(buffer.format != PIXEL_NV12 || (buffer.width % 2 == 0 && buffer.height % 2 == 0));
+
+    int type = getPixelType(buffer.format);
+    assert(buffer.stride >= std::size_t(buffer.width) * CV_ELEM_SIZE(type));
+
+    // the NV12 chroma plane below the luma is never read
+    return cv::Mat(buffer.height, buffer.width, type, const_cast<std::uint8_t*>(buffer.data), buffer.stride);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <cstddef>
+#include <cstdint>
+
+
+enum PixelFormat {
+    PIXEL_GRAY8,        // 8-bit luma
+    PIXEL_RGB,          // packed 8-bit R, G, B
+    PIXEL_BGR,          // packed 8-bit B, G, R
+    PIXEL_NV12,         // 8-bit luma plane followed by the interleaved U, V plane at half resolution
+    PIXEL_YUYV          // packed Y0, U, Y1, V per 2 pixels
+};
+
+
+// A frame in caller memory. Nothing is copied, the memory has to stay valid
+// and unchanged while the frame is processed.
+struct ImageBuffer {
+    const std::uint8_t* data    = nullptr;
+    int                 width   = 0;
+    int                 height  = 0;
+    std::size_t         stride  = 0;        // bytes per row, of the luma plane for NV12
+    PixelFormat         format  = PIXEL_RGB;
+    bool                bottomUp = false;   // last row first, as glReadPixels() stores frames
+};
+
+
+// OpenCV type wrapImageBuffer() gives for a format
+int getPixelType(PixelFormat format);
+
+// True if the format's grey image is its luma plane, shared without copying
+bool hasLumaPlane(PixelFormat format);
+
+// Wraps the buffer into a cv::Mat header without copying: GRAY8 and NV12 as their
+// luma plane, RGB and BGR as CV_8UC3, YUYV as CV_8UC2 with the luma in channel 0.
+// The header is writable for OpenCV's sake only, the pixels must not be modified.
+// Rows stay in memory order, bottomUp is left to getGreyImage().
+cv::Mat wrapImageBuffer(const ImageBuffer& buffer);
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+
+// Values by 64-bit key, bounded by the sum of their costs (e.g. bytes). Once an insert
+// goes above maxCost the least recently used entries are evicted, the new one never.
+// Not thread-safe.
+template <typename Value>
+class LruCache {
+public:
+    typedef std::uint64_t Key;
+
+    explicit LruCache(std::size_t maxCost) : maxCost(maxCost), totalCost(0) {
+        assert(maxCost > 0);
+    }
+
+    // Value of the key marked as most recently used, nullptr if it isn't cached
+    Value* find(Key key) {
+        auto it = index.find(key);
+
+        if (it == index.end())
+            return nullptr;
+
+        entries.splice(entries.begin(), entries, it->second);
+        return &it->second->value;
+    }
+
+    // Add a value that isn't cached yet. Evicted values are passed to evict(Value&)
+    // before they are destroyed, e.g. to free resources they refer to.
+    template <typename Evict>
+    Value& insert(Key key, Value value, std::size_t cost, Evict evict) {
+        assert(index.find(key) == index.end());
+
+        entries.push_front({ key, std::move(value), cost });
+        index[key] = entries.begin();
+        totalCost += cost;
+
+        while (totalCost > maxCost && entries.size() > 1) {
+            auto& last = entries.back();
+
+            evict(last.value);
+            totalCost -= last.cost;
+            index.erase(last.key);
+            entries.pop_back();
+        }
+
+        return entries.front().value;
+    }
+
+    Value& insert(Key key, Value value, std::size_t cost) {
+        return insert(key, std::move(value), cost, [](Value&) {});
+    }
+
+    // Evicts everything
+    template <typename Evict>
+    void clear(Evict evict) {
+        for (auto& entry : entries) {
+            evict(entry.value);
+        }
+
+        entries.clear();
+        index.clear();
+        totalCost = 0;
+    }
+
+    void clear() {
+        clear([](Value&) {});
+    }
+
+    std::size_t size() const { return entries.size(); }
+    std::size_t cost() const { return totalCost; }
+
+private:
+    struct Entry {
+        Key             key;
+        Value           value;
+        std::size_t     cost;
+    };
+
+    typedef std::list<Entry> EntryList;     // most recently used first
+
+    EntryList                                           entries;
+    std::unordered_map<Key, typename EntryList::iterator> index;
+    std::size_t                                         maxCost;
+    std::size_t                                         totalCost;
+};
@@ -1,39 +1,56 @@
 
 #include "Marker.h"
+#include "MarkerLayout.h"
 
 #include <opencv2/opencv.hpp>
 #include <cassert>
 
 
-// Marker and frame size in meters
-const double Marker::MARKER_SIZE = 0.3;
-const double Marker::FRAME_WIDTH = 0.02;
+constexpr double Marker::MARKER_SIZE;
+constexpr double Marker::FRAME_WIDTH;
+constexpr int    Marker::NUM_SQUARES;
+constexpr int    Marker::MIN_NUM_SQUARES;
+constexpr int    Marker::MAX_NUM_SQUARES;
 
-// NUM_SQUARES*NUM_SQUARES = total number of fields on a marker
-const int Marker::NUM_SQUARES = 3;
+// checks NUM_SQUARES range
+static_assert(MarkerGrid<Marker::NUM_SQUARES>::NUM_SQUARES == Marker::NUM_SQUARES, "");
 
-static_assert(Marker::NUM_SQUARES >= 2, "Need at least 4 squares to calculate rotation");
-static_assert(Marker::NUM_SQUARES <= 6, "Maximum 6*6-4=32 bits for marker id");
 
-
-Marker::Marker(int markerId, Translation trans, Rotation rot)
-    : id(markerId), t(trans), r(rot) {
-    assert(markerId >= 0);
-    assert(markerId < (1 << (NUM_SQUARES*NUM_SQUARES - 4)));
+Marker::Marker(std::uint32_t markerId, Translation trans, Rotation rot, int numSquares)
+    : id(markerId), t(trans), r(rot), numSquares(numSquares) {
+    assert(numSquares >= MIN_NUM_SQUARES && numSquares <= MAX_NUM_SQUARES);
+    assert(std::uint64_t(markerId) < (std::uint64_t(1) << (numSquares*numSquares - 4)));
 }
 
 
+// Runtime access to the MarkerGrid<N> tables
+template <int N>
+struct CornerSquareId {
+    static int run(MarkerCorner corner) {
+        return MarkerGrid<N>::CORNER_IDS[corner];
+    }
+};
+
+
+template <int N>
+struct BitSquareIds {
+    static std::vector<int> run() {
+        return{ std::begin(MarkerGrid<N>::BIT_SQUARE_IDS), std::end(MarkerGrid<N>::BIT_SQUARE_IDS) };
+    }
+};
+
+
 int getFrameSize(int markerSizePx) {
     return int(Marker::FRAME_WIDTH / Marker::MARKER_SIZE * markerSizePx);
 }
 
 
-cv::Rect getSquare(int markerSizePx, int squareId) {
+cv::Rect getSquare(int markerSizePx, int squareId, int numSquares) {
     int tex_frame_size = getFrameSize(markerSizePx);
-    int tex_square_size = (markerSizePx - 2 * getFrameSize(markerSizePx)) / Marker::NUM_SQUARES;
+    int tex_square_size = (markerSizePx - 2 * getFrameSize(markerSizePx)) / numSquares;
 
-    int col = squareId % Marker::NUM_SQUARES;
-    int row = squareId / Marker::NUM_SQUARES;
+    int col = squareId % numSquares;
+    int row = squareId / numSquares;
 
     int x = tex_frame_size + col * tex_square_size;
     int y = tex_frame_size + row * tex_square_size;
@@ -42,18 +59,8 @@ cv::Rect getSquare(int markerSizePx, int squareId) {
 }
 
 
-int getCornerSquareId(MarkerCorner corner) {
-    int fields = Marker::NUM_SQUARES;
-
-    switch (corner) {
-        case UPPER_LEFT:    return 0;
-        case UPPER_RIGHT:   return fields - 1;
-        case LOWER_LEFT:    return fields * (fields - 1);
-        case LOWER_RIGHT:   return fields * fields - 1;
-    }
-
-    assert(false);
-    return -1;
+int getCornerSquareId(MarkerCorner corner, int numSquares) {
+    return dispatchGridSize<CornerSquareId>(numSquares, corner);
 }
 
 
@@ -69,28 +76,36 @@ std::vector<cv::Rect> getFrameElements(int markerSizePx) {
 }
 
 
-cv::Rect getSquare(int markerSizePx, MarkerCorner corner) {
-    int squareId = getCornerSquareId(corner);
-    return getSquare(markerSizePx, squareId);
+cv::Rect getSquare(int markerSizePx, MarkerCorner corner, int numSquares) {
+    int squareId = getCornerSquareId(corner, numSquares);
+    return getSquare(markerSizePx, squareId, numSquares);
 }
 
 
-std::vector<cv::Rect> getIdSquares(int markerSizePx) {
-    int allFields = Marker::NUM_SQUARES * Marker::NUM_SQUARES;
+std::vector<cv::Rect> getIdSquares(int markerSizePx, int numSquares) {
     std::vector<cv::Rect> result;
 
-    for (int squareId = 1; squareId < allFields-1; squareId++) {
-        if (squareId == getCornerSquareId(UPPER_RIGHT) ||
-            squareId == getCornerSquareId(LOWER_LEFT)) continue;
-
-        result.push_back(getSquare(markerSizePx, squareId));
+    for (int squareId : dispatchGridSize<BitSquareIds>(numSquares)) {
+        result.push_back(getSquare(markerSizePx, squareId, numSquares));
     }
 
     return result;
 }
 
 
+cv::Mat createMarkerImage(const Marker& marker, int markerSizePx) {
+    cv::Mat image{ markerSizePx, markerSizePx, CV_8UC3, CV_RGB(255, 255, 255) };
 
+    auto squares = getIdSquares(markerSizePx, marker.numSquares);
+    auto blackCorner = getSquare(markerSizePx, UPPER_RIGHT, marker.numSquares);
 
+    image(blackCorner) = CV_RGB(0, 0, 0);
 
+    for (int bitIndex = 0; bitIndex < int(squares.size()); bitIndex++) {
+        if (~marker.id & (1u << bitIndex)) {
+            image(squares[bitIndex]) = CV_RGB(0, 0, 0);
+        }
+    }
 
+    return image;
+}
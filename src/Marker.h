@@ -3,6 +3,7 @@
 #include "Transformation.h"
 
 #include <opencv2/opencv.hpp>
+#include <cstdint>
 #include <vector>
 
 
@@ -15,15 +16,22 @@ enum MarkerCorner {
 
 
 struct Marker {
-    static const double MARKER_SIZE;
-    static const double FRAME_WIDTH;
-    static const int    NUM_SQUARES;
-
-    explicit Marker(int markerId = 0, Translation t = {}, Rotation r = {});
-
-    Translation t;
-    Rotation    r;
-    int         id;
+    // Marker and frame size in meters
+    static constexpr double MARKER_SIZE = 0.3;
+    static constexpr double FRAME_WIDTH = 0.02;
+
+    // NUM_SQUARES*NUM_SQUARES = total number of fields on a marker,
+    // default grid size within the supported range
+    static constexpr int    NUM_SQUARES     = 3;
+    static constexpr int    MIN_NUM_SQUARES = 2;
+    static constexpr int    MAX_NUM_SQUARES = 6;
+
+    explicit Marker(std::uint32_t markerId = 0, Translation t = {}, Rotation r = {}, int numSquares = NUM_SQUARES);
+
+    Translation     t;
+    Rotation        r;
+    std::uint32_t   id;
+    int             numSquares;
 };
 
 
@@ -32,10 +40,22 @@ std::vector<cv::Rect> getFrameElements(int markerSizePx);
 
 
 // Get a particular corner square
-cv::Rect getSquare(int markerSizePx, MarkerCorner corner);
+cv::Rect getSquare(int markerSizePx, MarkerCorner corner, int numSquares = Marker::NUM_SQUARES);
+
+
+// Get a square given its row-major index
+cv::Rect getSquare(int markerSizePx, int squareId, int numSquares = Marker::NUM_SQUARES);
+
+
+// Row-major index of a corner square
+int getCornerSquareId(MarkerCorner corner, int numSquares = Marker::NUM_SQUARES);
 
 
 // Get squares that make up the id of a marker
 // order: vector index == bit number (0 is LSB)
-std::vector<cv::Rect> getIdSquares(int markerSizePx);
+std::vector<cv::Rect> getIdSquares(int markerSizePx, int numSquares = Marker::NUM_SQUARES);
+
+
+// Create an RGB image of the marker in the standard upright position
+cv::Mat createMarkerImage(const Marker& marker, int markerSizePx);
 
@@ -0,0 +1,341 @@
+#include "MarkerDetector.h"
+#include "RecognitionStages.h"
+#include "Decoding.h"
+#include "GreyConversion.h"
+#include "Binarization.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <functional>
+#include <limits>
+
+
+MarkerDetector::MarkerDetector(const Camera& camera, const DetectorParams& params)
+    : camera(camera), params(params), pool(params.parallel ? &ThreadPool::shared() : nullptr),
+      pyramidLevel(getPyramidLevel(params.minMarkerSizePx)), undistortion(camera) {
+    assert(params.samplesPerSide > 0);
+    assert(params.contourBands >= 0 && params.bandOverlap > 0);
+    assert(params.minMarkerSizePx >= 0);
+    assert(params.adaptiveWindow > 0 && params.adaptiveWindow % 2 == 1 && params.adaptiveWindow <= 255);
+    assert(!params.gridSizes.empty());
+
+    // ascending order breaks ties between grid sizes, see decodeMarkerCandidates()
+    auto& sizes = this->params.gridSizes;
+    std::sort(std::begin(sizes), std::end(sizes));
+    sizes.erase(std::unique(std::begin(sizes), std::end(sizes)), std::end(sizes));
+
+    assert(sizes.front() >= Marker::MIN_NUM_SQUARES);
+    assert(sizes.back() <= Marker::MAX_NUM_SQUARES);
+}
+
+
+const Camera& MarkerDetector::getCamera() const {
+    return camera;
+}
+
+
+const DetectorParams& MarkerDetector::getParams() const {
+    return params;
+}
+
+
+void MarkerDetector::processCandidate(const cv::Mat& sceneGrey, const Camera& regionCamera, const cv::Point& origin,
+                                      MarkerCandidate& candidate, bool timed) const {
+    std::fill(std::begin(candidate.stageNs), std::end(candidate.stageNs), 0.0);
+    StageTimer timer{ timed ? candidate.stageNs : nullptr };
+
+    if (params.decodeMode == DECODE_WARP) {
+        undistortMarkerImage(sceneGrey, candidate, NORMALIZED_MARKER_SIZE);
+        integrateMarkerImage(candidate);
+    }
+
+    // the warp reads the scene through the detected quad, sampling and the pose use the ideal one
+    if (!undistortion.empty()) {
+        undistortion.undistort(candidate.quad, origin);
+    }
+
+    timer.lap(STAGE_UNDISTORT);
+
+    const Camera* lens = undistortion.empty() ? nullptr : &regionCamera;
+    decodeMarkerCandidate(sceneGrey, candidate, params, VALID_MARKER_TOLERANCE, lens);
+    timer.lap(STAGE_DECODE);
+}
+
+
+void MarkerDetector::solvePoses(DetectorFrame& frame, const Camera& regionCamera, RecognitionStats* stats) const {
+    StageTimer timer{ stats };
+    auto& candidates = frame.candidates;
+    auto& batch = frame.poseBatch;
+
+    batch.clear();
+    batch.setCamera(regionCamera);
+    frame.batchedCandidates.clear();
+    frame.warmStarted.assign(candidates.size(), 0);
+
+    // warm starts refine one marker each, the cache is only read meanwhile
+    auto warmStart = [&](std::size_t i) {
+        auto& candidate = candidates[i];
+        const PlanarPose* previous = poseCache.find(PoseCache::getKey(candidate.decoding.numSquares, candidate.decoding.id));
+
+        if (previous && warmStartSquarePose(regionCamera, candidate.quad, Marker::MARKER_SIZE, *previous, candidate.cameraPose)) {
+            candidate.pose = getTransformation(candidate.cameraPose.R, candidate.cameraPose.t);
+            frame.warmStarted[i] = 1;
+        }
+    };
+
+    if (params.warmStartPose && pool) {
+        // by reference, so std::function doesn't allocate
+        pool->parallelFor(candidates.size(), std::ref(warmStart));
+    }
+    else if (params.warmStartPose) {
+        for (std::size_t i = 0; i < candidates.size(); i++) {
+            warmStart(i);
+        }
+    }
+
+    for (std::size_t i = 0; i < candidates.size(); i++) {
+        if (!frame.warmStarted[i]) {
+            frame.batchedCandidates.push_back(i);
+            batch.add(candidates[i].quad);
+        }
+    }
+
+    batch.solve(Marker::MARKER_SIZE, POSE_REFINE_ITERATIONS, pool);
+
+    for (std::size_t j = 0; j < batch.size(); j++) {
+        auto& candidate = candidates[frame.batchedCandidates[j]];
+        const auto& solutions = batch.getSolutions(j);
+
+        if (solutions.count == 0) {
+            candidate.cameraPose.error = std::numeric_limits<double>::infinity();
+            candidate.pose = {};
+            continue;
+        }
+
+        const PlanarPose* previous = nullptr;
+
+        if (params.warmStartPose) {
+            previous = poseCache.find(PoseCache::getKey(candidate.decoding.numSquares, candidate.decoding.id));
+        }
+
+        candidate.cameraPose = selectSquarePose(solutions, previous);
+        candidate.pose = getTransformation(candidate.cameraPose.R, candidate.cameraPose.t);
+    }
+
+    timer.lap(STAGE_POSE);
+}
+
+
+void MarkerDetector::convertToGrey(const cv::Mat& sceneRGB, DetectorFrame& frame, RecognitionStats* stats) const {
+    convertToGrey(sceneRGB, PIXEL_RGB, false, frame, stats);
+}
+
+
+void MarkerDetector::convertToGrey(const cv::Mat& scene, PixelFormat format, bool bottomUp, DetectorFrame& frame,
+                                   RecognitionStats* stats) const {
+    StageTimer timer{ stats };
+
+    // at full resolution the global threshold is a free by-product
+    frame.binarized = pyramidLevel == 0 && format == PIXEL_RGB && params.binarization == BINARIZE_GLOBAL;
+
+    // never into sceneGrey, it may still share the luma plane of a previous ImageBuffer
+    if (frame.binarized) {
+        convertToGreyAndBinary(scene, frame.greyBuffer, frame.sceneBinary, int(BINARIZATION_THRESHOLD), bottomUp);
+        frame.sceneGrey = frame.greyBuffer;
+    }
+    else {
+        getGreyImage(scene, format, bottomUp, frame.greyBuffer, frame.sceneGrey);
+    }
+
+    timer.lap(STAGE_GREY);
+}
+
+
+void MarkerDetector::findQuads(DetectorFrame& frame, RecognitionStats* stats) const {
+    StageTimer timer{ stats };
+
+    frame.candidates.clear();
+
+    // contours of a coarse level, the limits shrink along with the image
+    int scale = 1 << pyramidLevel;
+    int minContourLen = std::max(MIN_CONTOUR_LEN / scale, 4);
+    double minQuadArea = MIN_QUAD_AREA / (scale * scale);
+    int overlap = std::max(params.bandOverlap / scale, 1);
+
+    if (pyramidLevel > 0) {
+        cv::Size coarseSize{ frame.sceneGrey.cols / scale, frame.sceneGrey.rows / scale };
+        cv::resize(frame.sceneGrey, frame.contourGrey, coarseSize, 0.0, 0.0, cv::INTER_AREA);
+    }
+    else {
+        frame.contourGrey = frame.sceneGrey;
+    }
+
+    if (params.binarization == BINARIZE_ADAPTIVE) {
+        int window = std::max(params.adaptiveWindow / scale, 1) | 1;
+        adaptiveThreshold(frame.contourGrey, frame.thresholdIntegral, frame.sceneBinary, window, params.adaptiveOffset);
+        frame.binarized = true;
+    }
+
+    int numBands = params.contourBands;
+
+    if (numBands == 0) {
+        numBands = getNumContourBands(frame.contourGrey.rows, overlap, pool ? pool->size() : 1);
+    }
+
+    if (numBands > 1 && frame.binarized) {
+        findContoursTiled(frame.sceneBinary, frame.contourBands, numBands, overlap, pool, frame.contours, true);
+    }
+    else if (numBands > 1) {
+        findContoursTiled(frame.contourGrey, frame.contourBands, numBands, overlap, pool, frame.contours);
+    }
+    else if (frame.binarized) {
+        findBinaryContours(frame.sceneBinary, frame.contours);
+    }
+    else {
+        findContours(frame.contourGrey, frame.sceneBinary, frame.contours);
+    }
+
+    timer.lap(STAGE_CONTOURS);
+
+    getPreciseQuads(frame.sceneGrey, frame.contours, minContourLen, minQuadArea, frame.quadBuffer, frame.candidates, scale);
+    timer.lap(STAGE_QUADS);
+
+    if (stats) {
+        stats->numContours = int(std::count_if(std::begin(frame.contours), std::end(frame.contours),
+            [minContourLen](const Contour& c) { return int(c.size()) >= minContourLen; }));
+        stats->numQuads = int(frame.candidates.size());
+    }
+}
+
+
+void MarkerDetector::decodeQuads(DetectorFrame& frame, RecognitionStats* stats) const {
+    auto& candidates = frame.candidates;
+    const auto& sceneGrey = frame.sceneGrey;
+    bool timed = stats != nullptr;
+
+    frame.markers.clear();
+
+    // quads are relative to the region, so is the principal point
+    Camera regionCamera = camera;
+    regionCamera.principalX -= frame.origin.x;
+    regionCamera.principalY -= frame.origin.y;
+
+    auto process = [&](std::size_t i) {
+        processCandidate(sceneGrey, regionCamera, frame.origin, candidates[i], timed);
+    };
+
+    if (pool) {
+        // by reference, so std::function doesn't allocate
+        pool->parallelFor(candidates.size(), std::ref(process));
+    }
+    else {
+        for (std::size_t i = 0; i < candidates.size(); i++) {
+            process(i);
+        }
+    }
+
+    if (stats) {
+        stats->numWarped = int(candidates.size());
+
+        for (std::size_t i = 0; i < candidates.size(); i++) {
+            for (auto stage : { STAGE_UNDISTORT, STAGE_DECODE }) {
+                stats->stageNs[stage] += candidates[i].stageNs[stage];
+            }
+        }
+    }
+
+    candidates.filter([](const MarkerCandidate& candidate) {
+        return candidate.decoding.numSquares != 0;
+    });
+
+    solvePoses(frame, regionCamera, stats);
+
+    if (params.warmStartPose) {
+        for (std::size_t i = 0; i < candidates.size(); i++) {
+            const auto& decoding = candidates[i].decoding;
+
+            if (std::isfinite(candidates[i].cameraPose.error)) {
+                poseCache.update(PoseCache::getKey(decoding.numSquares, decoding.id), candidates[i].cameraPose);
+            }
+        }
+    }
+
+    // gathered in candidate order, whichever thread finished first
+    for (std::size_t i = 0; i < candidates.size(); i++) {
+        const auto& decoding = candidates[i].decoding;
+        const auto& pose = candidates[i].pose;
+
+        frame.markers.push_back({ Marker(decoding.id, pose.t, pose.r, decoding.numSquares), decoding.score });
+    }
+
+    if (stats) {
+        stats->numValid = int(candidates.size());
+        stats->numMarkers = int(frame.markers.size());
+    }
+}
+
+
+const std::vector<MarkerScore>& MarkerDetector::detect(const cv::Mat& sceneRGB, RecognitionStats* stats) {
+    nextFrame();
+    return detect(sceneRGB, cv::Rect{ 0, 0, sceneRGB.cols, sceneRGB.rows }, stats);
+}
+
+
+const std::vector<MarkerScore>& MarkerDetector::detect(const cv::Mat& sceneRGB, const cv::Rect& region, RecognitionStats* stats) {
+    return detectScene(sceneRGB, PIXEL_RGB, false, region, stats);
+}
+
+
+const std::vector<MarkerScore>& MarkerDetector::detect(const ImageBuffer& buffer, RecognitionStats* stats) {
+    nextFrame();
+    return detect(buffer, cv::Rect{ 0, 0, buffer.width, buffer.height }, stats);
+}
+
+
+const std::vector<MarkerScore>& MarkerDetector::detect(const ImageBuffer& buffer, const cv::Rect& region, RecognitionStats* stats) {
+    return detectScene(wrapImageBuffer(buffer), buffer.format, buffer.bottomUp, region, stats);
+}
+
+
+void MarkerDetector::nextFrame() {
+    if (params.warmStartPose) {
+        poseCache.nextFrame();
+    }
+}
+
+
+const std::vector<MarkerScore>& MarkerDetector::detectScene(const cv::Mat& scene, PixelFormat format, bool bottomUp,
+                                                            const cv::Rect& region, RecognitionStats* stats) {
+    assert((region & cv::Rect{ 0, 0, scene.cols, scene.rows }) == region);
+
+    if (stats) {
+        *stats = {};
+    }
+
+    StageTimer timer{ stats };
+
+    // rows of the region as stored
+    cv::Rect stored = region;
+
+    if (bottomUp) {
+        stored.y = scene.rows - region.y - region.height;
+    }
+
+    cv::Mat regionScene = scene(stored);
+    frame.origin = region.tl();
+
+    convertToGrey(regionScene, format, bottomUp, frame, stats);
+    findQuads(frame, stats);
+    decodeQuads(frame, stats);
+
+    timer.stop();
+
+#ifdef DEBUG_MARKERS
+    if (format == PIXEL_RGB && !bottomUp) {
+        debugMarkers(regionScene, frame.candidates, frame.markers);
+    }
+#endif
+
+    return frame.markers;
+}
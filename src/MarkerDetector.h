@@ -0,0 +1,96 @@
+#pragma once
+
+#include "Camera.h"
+#include "ImageBuffer.h"
+#include "PoseBatch.h"
+#include "PoseCache.h"
+#include "Recognition.h"
+#include "RecognitionStages.h"
+#include "Statistics.h"
+#include "ThreadPool.h"
+#include "Undistortion.h"
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+
+// Per-frame buffers of MarkerDetector, one for every frame in flight
+struct DetectorFrame {
+    cv::Point                   origin;         // scene position of the region below
+    cv::Mat                     sceneGrey;
+    cv::Mat                     greyBuffer;     // sceneGrey unless it shares the luma plane of the input
+    cv::Mat                     contourGrey;    // sceneGrey on the contour pyramid level
+    cv::Mat                     sceneBinary;
+    bool                        binarized = false;  // sceneBinary is ready for findBinaryContours()
+    cv::Mat                     thresholdIntegral;  // BINARIZE_ADAPTIVE window sums
+    std::vector<Contour>        contours;
+    std::vector<ContourBand>    contourBands;
+    Contour                     quadBuffer;
+    CandidateList               candidates;
+    SquarePoseBatch             poseBatch;
+    std::vector<std::size_t>    batchedCandidates;  // candidate index of every poseBatch square
+    std::vector<unsigned char>  warmStarted;        // per candidate, set by parallel warm starts
+    std::vector<MarkerScore>    markers;
+};
+
+
+// Stateful version of recognizeMarkers(). Owns every per-frame buffer,
+// so a detector that is kept between frames does not reallocate them.
+// Candidates are processed in parallel, results keep the serial order.
+class MarkerDetector {
+public:
+    explicit MarkerDetector(const Camera& camera, const DetectorParams& params = DetectorParams());
+
+    // Recognizes markers in the RGB scene, the result is valid until the next call
+    const std::vector<MarkerScore>& detect(const cv::Mat& sceneRGB, RecognitionStats* stats = nullptr);
+
+    // Same as above, restricted to a region of the scene. Poses stay in scene camera space.
+    // Doesn't start a new frame, so many regions of one frame can be detected, see nextFrame().
+    const std::vector<MarkerScore>& detect(const cv::Mat& sceneRGB, const cv::Rect& region, RecognitionStats* stats = nullptr);
+
+    // Recognizes markers in a frame in caller memory without copying it, see wrapImageBuffer().
+    // GRAY8 and NV12 luma is read in place, the buffer must stay valid until the call returns.
+    // Regions are given top-down for bottomUp buffers too.
+    const std::vector<MarkerScore>& detect(const ImageBuffer& buffer, RecognitionStats* stats = nullptr);
+    const std::vector<MarkerScore>& detect(const ImageBuffer& buffer, const cv::Rect& region, RecognitionStats* stats = nullptr);
+
+    // Start the next video frame, poses of markers not seen for a while leave the warm start
+    // cache. Whole frame detect() calls do it, region ones and decodeQuads() leave it to the caller.
+    void nextFrame();
+
+    // Stages of detect() on external buffers, for pipelining frames across threads.
+    // Each adds its durations and counts to stats if given, none sets the total.
+    // sceneRGB may be a region of the scene starting at frame.origin.
+    void convertToGrey(const cv::Mat& sceneRGB, DetectorFrame& frame, RecognitionStats* stats) const;
+    void convertToGrey(const cv::Mat& scene, PixelFormat format, bool bottomUp, DetectorFrame& frame, RecognitionStats* stats) const;
+    void findQuads(DetectorFrame& frame, RecognitionStats* stats) const;
+    void decodeQuads(DetectorFrame& frame, RecognitionStats* stats) const;
+
+    const Camera& getCamera() const;
+    const DetectorParams& getParams() const;
+
+private:
+    // All stages of detect() on a region of a scene in the given format
+    const std::vector<MarkerScore>& detectScene(const cv::Mat& scene, PixelFormat format, bool bottomUp,
+                                                const cv::Rect& region, RecognitionStats* stats);
+
+    // Undistort and decode one candidate, independent of the others.
+    // regionCamera and origin place the region of sceneGrey in the scene.
+    void processCandidate(const cv::Mat& sceneGrey, const Camera& regionCamera, const cv::Point& origin,
+                          MarkerCandidate& candidate, bool timed) const;
+
+    // Poses of the decoded candidates, warm started ones alone and the rest in one batch
+    void solvePoses(DetectorFrame& frame, const Camera& regionCamera, RecognitionStats* stats) const;
+
+    Camera                      camera;
+    DetectorParams              params;
+    ThreadPool*                 pool;           // nullptr runs serially
+    int                         pyramidLevel;
+    UndistortionMap             undistortion;   // empty without lens distortion
+
+    // read by solvePoses(), updated by decodeQuads() and aged by nextFrame(),
+    // so decodeQuads() must not run on two frames at once
+    mutable PoseCache           poseCache;
+
+    DetectorFrame               frame;
+};
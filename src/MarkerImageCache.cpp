@@ -0,0 +1,61 @@
+#include "MarkerImageCache.h"
+
+#include <cassert>
+
+
+MarkerImageCache::MarkerImageCache(std::size_t maxBytes) : images(maxBytes) {
+}
+
+
+MarkerImageCache& MarkerImageCache::shared() {
+    static MarkerImageCache cache;
+    return cache;
+}
+
+
+std::uint64_t MarkerImageCache::getKey(const Marker& marker, int markerSizePx) {
+    assert(markerSizePx > 0 && markerSizePx < (1 << 24));
+
+    // 32 ID bits, 8 for the grid size, 24 for the image size
+    return std::uint64_t(marker.id) | (std::uint64_t(marker.numSquares) << 32) | (std::uint64_t(markerSizePx) << 40);
+}
+
+
+cv::Mat MarkerImageCache::get(const Marker& marker, int markerSizePx) {
+    auto key = getKey(marker, markerSizePx);
+
+    {
+        std::lock_guard<std::mutex> lock{ mutex };
+
+        if (const cv::Mat* image = images.find(key))
+            return *image;
+    }
+
+    // generated unlocked, if two threads race for the same image the later one takes the cached one
+    cv::Mat image = createMarkerImage(marker, markerSizePx);
+
+    std::lock_guard<std::mutex> lock{ mutex };
+
+    if (const cv::Mat* cached = images.find(key))
+        return *cached;
+
+    return images.insert(key, image, image.total() * image.elemSize());
+}
+
+
+void MarkerImageCache::clear() {
+    std::lock_guard<std::mutex> lock{ mutex };
+    images.clear();
+}
+
+
+std::size_t MarkerImageCache::size() const {
+    std::lock_guard<std::mutex> lock{ mutex };
+    return images.size();
+}
+
+
+std::size_t MarkerImageCache::bytes() const {
+    std::lock_guard<std::mutex> lock{ mutex };
+    return images.cost();
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "LruCache.h"
+#include "Marker.h"
+
+#include <opencv2/opencv.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+
+const std::size_t MARKER_IMAGE_CACHE_BYTES = 64 << 20;
+
+
+// createMarkerImage() results by grid size, ID and image size, generated on first use.
+// The least recently used images go once the cache holds more than maxBytes.
+// Safe to use from many threads.
+class MarkerImageCache {
+public:
+    explicit MarkerImageCache(std::size_t maxBytes = MARKER_IMAGE_CACHE_BYTES);
+
+    // Cache of the process, e.g. for renderScene()
+    static MarkerImageCache& shared();
+
+    // Key of a marker image, see LruCache
+    static std::uint64_t getKey(const Marker& marker, int markerSizePx);
+
+    // Image of the marker, shared with the cache so it must not be modified.
+    // It stays valid after an eviction.
+    cv::Mat get(const Marker& marker, int markerSizePx);
+
+    void clear();
+
+    std::size_t size() const;
+    std::size_t bytes() const;
+
+private:
+    LruCache<cv::Mat>   images;
+    mutable std::mutex  mutex;
+};
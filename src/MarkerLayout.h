@@ -0,0 +1,215 @@
+#pragma once
+
+#include "Marker.h"
+
+#include <opencv2/opencv.hpp>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <utility>
+
+
+// Compile-time marker geometry. MarkerGrid<N> holds the index tables of an N*N grid,
+// MarkerLayout<N, SizePx> adds pixel rects of a marker image with SizePx side length.
+// Everything is a constant expression, so per-field loops have a fixed trip count.
+
+
+// cv::Rect is not a literal type, this one can live in constexpr tables
+struct LayoutRect {
+    int x, y, width, height;
+
+    constexpr int area() const { return width * height; }
+
+    operator cv::Rect() const { return{ x, y, width, height }; }
+};
+
+
+// C++11 replacement of std::index_sequence
+template <int... I>
+struct IndexSequence {};
+
+template <int N, int... I>
+struct MakeIndexSequence : MakeIndexSequence<N - 1, N - 1, I...> {};
+
+template <int... I>
+struct MakeIndexSequence<0, I...> {
+    typedef IndexSequence<I...> type;
+};
+
+
+// Functions generating the grid tables (a class can't call its own constexpr
+// functions while it is still incomplete, hence the separate struct)
+template <int N>
+struct MarkerGridFunctions {
+    static constexpr int cornerSquareId(int corner) {
+        return corner == UPPER_LEFT  ? 0 :
+               corner == UPPER_RIGHT ? N - 1 :
+               corner == LOWER_LEFT  ? N * (N - 1) :
+                                       N * N - 1;
+    }
+
+    // the n-th square that is not a corner, see getIdSquares()
+    static constexpr int skipLowerLeft(int squareId) {
+        return squareId >= N * (N - 1) ? squareId + 1 : squareId;
+    }
+
+    static constexpr int bitSquareId(int bit) {
+        return skipLowerLeft(bit + 1 >= N - 1 ? bit + 2 : bit + 1);
+    }
+
+    // source of a square after rotating the grid by 90 degrees clockwise
+    static constexpr int rotate90Source(int squareId) {
+        return (N - 1 - squareId % N) * N + squareId / N;
+    }
+
+    // source of a square after rotating the grid by turns*90 degrees clockwise
+    static constexpr int rotateSource(int squareId, int turns) {
+        return turns == 0 ? squareId : rotateSource(rotate90Source(squareId), turns - 1);
+    }
+
+    template <int... I>
+    static constexpr std::array<int, sizeof...(I)> bitSquareIds(int turns, IndexSequence<I...>) {
+        return{ { rotateSource(bitSquareId(I), turns)... } };
+    }
+
+    static constexpr std::uint64_t cornerBits() {
+        return (std::uint64_t(1) << cornerSquareId(UPPER_LEFT)) | (std::uint64_t(1) << cornerSquareId(UPPER_RIGHT)) |
+               (std::uint64_t(1) << cornerSquareId(LOWER_LEFT)) | (std::uint64_t(1) << cornerSquareId(LOWER_RIGHT));
+    }
+};
+
+
+template <int N>
+struct MarkerGrid {
+    static_assert(N >= Marker::MIN_NUM_SQUARES, "Need at least 4 squares to calculate rotation");
+    static_assert(N <= Marker::MAX_NUM_SQUARES, "Maximum 6*6-4=32 bits for marker id");
+
+    typedef MarkerGridFunctions<N> Functions;
+
+    static constexpr int NUM_SQUARES = N;               // per side
+    static constexpr int NUM_FIELDS  = N * N;
+    static constexpr int NUM_BITS    = N * N - 4;
+
+    // indexed by MarkerCorner
+    static constexpr std::array<int, 4> CORNER_IDS = { {
+        Functions::cornerSquareId(UPPER_LEFT),
+        Functions::cornerSquareId(UPPER_RIGHT),
+        Functions::cornerSquareId(LOWER_LEFT),
+        Functions::cornerSquareId(LOWER_RIGHT) } };
+
+    // bit number -> row-major square index
+    static constexpr std::array<int, NUM_BITS> BIT_SQUARE_IDS =
+        Functions::bitSquareIds(0, typename MakeIndexSequence<NUM_BITS>::type());
+
+    // Tables of a grid read as is, that becomes upright after turns*90 degrees clockwise.
+    // [turns][bit number] -> row-major square index
+    static constexpr std::array<std::array<int, NUM_BITS>, 4> TURNED_BIT_SQUARE_IDS = { {
+        Functions::bitSquareIds(0, typename MakeIndexSequence<NUM_BITS>::type()),
+        Functions::bitSquareIds(1, typename MakeIndexSequence<NUM_BITS>::type()),
+        Functions::bitSquareIds(2, typename MakeIndexSequence<NUM_BITS>::type()),
+        Functions::bitSquareIds(3, typename MakeIndexSequence<NUM_BITS>::type()) } };
+
+    // [turns] -> row-major index of the black corner
+    static constexpr std::array<int, 4> TURNED_BLACK_CORNER_IDS = { {
+        Functions::rotateSource(Functions::cornerSquareId(UPPER_RIGHT), 0),
+        Functions::rotateSource(Functions::cornerSquareId(UPPER_RIGHT), 1),
+        Functions::rotateSource(Functions::cornerSquareId(UPPER_RIGHT), 2),
+        Functions::rotateSource(Functions::cornerSquareId(UPPER_RIGHT), 3) } };
+
+    // corner squares in a word with one bit per square (row-major, LSB first)
+    static constexpr std::uint64_t CORNER_BITS = Functions::cornerBits();
+};
+
+
+template <int N> constexpr int MarkerGrid<N>::NUM_SQUARES;
+template <int N> constexpr int MarkerGrid<N>::NUM_FIELDS;
+template <int N> constexpr int MarkerGrid<N>::NUM_BITS;
+template <int N> constexpr std::array<int, 4> MarkerGrid<N>::CORNER_IDS;
+template <int N> constexpr std::array<int, MarkerGrid<N>::NUM_BITS> MarkerGrid<N>::BIT_SQUARE_IDS;
+template <int N> constexpr std::array<std::array<int, MarkerGrid<N>::NUM_BITS>, 4> MarkerGrid<N>::TURNED_BIT_SQUARE_IDS;
+template <int N> constexpr std::array<int, 4> MarkerGrid<N>::TURNED_BLACK_CORNER_IDS;
+template <int N> constexpr std::uint64_t MarkerGrid<N>::CORNER_BITS;
+
+
+// Functions generating the pixel tables
+template <int N, int SizePx>
+struct MarkerLayoutFunctions {
+    static constexpr int FRAME_PX  = int(Marker::FRAME_WIDTH / Marker::MARKER_SIZE * SizePx);
+    static constexpr int SQUARE_PX = (SizePx - 2 * FRAME_PX) / N;
+
+    static constexpr LayoutRect square(int squareId) {
+        return{ FRAME_PX + squareId % N * SQUARE_PX, FRAME_PX + squareId / N * SQUARE_PX, SQUARE_PX, SQUARE_PX };
+    }
+
+    template <int... I>
+    static constexpr std::array<LayoutRect, sizeof...(I)> squares(IndexSequence<I...>) {
+        return{ { square(I)... } };
+    }
+
+    template <int... I>
+    static constexpr std::array<LayoutRect, sizeof...(I)> idSquares(IndexSequence<I...>) {
+        return{ { square(MarkerGridFunctions<N>::bitSquareId(I))... } };
+    }
+};
+
+
+template <int N, int SizePx>
+struct MarkerLayout : MarkerGrid<N> {
+    static_assert(SizePx > 2 * N, "Marker image is too small for its grid");
+
+    typedef MarkerGrid<N> Grid;
+    typedef MarkerLayoutFunctions<N, SizePx> Functions;
+
+    static constexpr int SIZE_PX   = SizePx;
+    static constexpr int FRAME_PX  = Functions::FRAME_PX;
+    static constexpr int SQUARE_PX = Functions::SQUARE_PX;
+
+    // up, down, left, right
+    static constexpr std::array<LayoutRect, 4> FRAME = { {
+        { 0, 0, SizePx, FRAME_PX },
+        { 0, SizePx - FRAME_PX, SizePx, FRAME_PX },
+        { 0, FRAME_PX, FRAME_PX, SizePx - 2 * FRAME_PX },
+        { SizePx - FRAME_PX, FRAME_PX, FRAME_PX, SizePx - 2 * FRAME_PX } } };
+
+    // all squares, row-major
+    static constexpr std::array<LayoutRect, Grid::NUM_FIELDS> SQUARES =
+        Functions::squares(typename MakeIndexSequence<Grid::NUM_FIELDS>::type());
+
+    // indexed by MarkerCorner
+    static constexpr std::array<LayoutRect, 4> CORNERS = { {
+        Functions::square(MarkerGridFunctions<N>::cornerSquareId(UPPER_LEFT)),
+        Functions::square(MarkerGridFunctions<N>::cornerSquareId(UPPER_RIGHT)),
+        Functions::square(MarkerGridFunctions<N>::cornerSquareId(LOWER_LEFT)),
+        Functions::square(MarkerGridFunctions<N>::cornerSquareId(LOWER_RIGHT)) } };
+
+    // index == bit number (0 is LSB)
+    static constexpr std::array<LayoutRect, Grid::NUM_BITS> ID_SQUARES =
+        Functions::idSquares(typename MakeIndexSequence<Grid::NUM_BITS>::type());
+};
+
+
+template <int N, int SizePx> constexpr int MarkerLayout<N, SizePx>::SIZE_PX;
+template <int N, int SizePx> constexpr int MarkerLayout<N, SizePx>::FRAME_PX;
+template <int N, int SizePx> constexpr int MarkerLayout<N, SizePx>::SQUARE_PX;
+template <int N, int SizePx> constexpr std::array<LayoutRect, 4> MarkerLayout<N, SizePx>::FRAME;
+template <int N, int SizePx> constexpr std::array<LayoutRect, MarkerGrid<N>::NUM_FIELDS> MarkerLayout<N, SizePx>::SQUARES;
+template <int N, int SizePx> constexpr std::array<LayoutRect, 4> MarkerLayout<N, SizePx>::CORNERS;
+template <int N, int SizePx> constexpr std::array<LayoutRect, MarkerGrid<N>::NUM_BITS> MarkerLayout<N, SizePx>::ID_SQUARES;
+
+
+// Calls Op<N>::run(args...) for a grid size known only at runtime. Dispatch once
+// per marker and keep the per-field work inside Op<N>, where N is a constant.
+template <template <int> class Op, typename... Args>
+auto dispatchGridSize(int numSquares, Args&&... args) -> decltype(Op<2>::run(std::forward<Args>(args)...)) {
+    static_assert(Marker::MIN_NUM_SQUARES == 2 && Marker::MAX_NUM_SQUARES == 6, "Update the cases below");
+
+    switch (numSquares) {
+        case 3: return Op<3>::run(std::forward<Args>(args)...);
+        case 4: return Op<4>::run(std::forward<Args>(args)...);
+        case 5: return Op<5>::run(std::forward<Args>(args)...);
+        case 6: return Op<6>::run(std::forward<Args>(args)...);
+        default:
+            assert(numSquares == 2);
+            return Op<2>::run(std::forward<Args>(args)...);
+    }
+}
@@ -0,0 +1,42 @@
+#include "MarkerTextureCache.h"
+#include "Rendering.h"
+
+
+void deleteTexture(GLuint& texture) {
+    glDeleteTextures(1, &texture);
+}
+
+
+MarkerTextureCache::MarkerTextureCache(std::size_t maxBytes, MarkerImageCache& imageCache)
+    : textures(maxBytes), imageCache(imageCache) {
+}
+
+
+MarkerTextureCache::~MarkerTextureCache() {
+    clear();
+}
+
+
+GLuint MarkerTextureCache::get(const Marker& marker, int textureSize) {
+    auto key = MarkerImageCache::getKey(marker, textureSize);
+
+    if (const GLuint* texture = textures.find(key))
+        return *texture;
+
+    // OpenGL likes its textures upside down
+    cv::Mat image;
+    cv::flip(imageCache.get(marker, textureSize), image, 0);
+
+    GLuint texture = createTexture(image.cols, image.rows, image.data);
+    return textures.insert(key, texture, image.total() * image.elemSize(), deleteTexture);
+}
+
+
+void MarkerTextureCache::clear() {
+    textures.clear(deleteTexture);
+}
+
+
+std::size_t MarkerTextureCache::size() const {
+    return textures.size();
+}
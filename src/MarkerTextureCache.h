@@ -0,0 +1,42 @@
+#pragma once
+
+#include "LruCache.h"
+#include "Marker.h"
+#include "MarkerImageCache.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#include <GL/GL.h>
+#include <cstddef>
+
+
+const std::size_t MARKER_TEXTURE_CACHE_BYTES = 64 << 20;
+
+
+// Marker textures by grid size, ID and texture size, created on first use from the images
+// of a MarkerImageCache. The least recently used textures are deleted once their pixels
+// take more than maxBytes. Only for the thread owning the OpenGL context.
+class MarkerTextureCache {
+public:
+    explicit MarkerTextureCache(std::size_t maxBytes = MARKER_TEXTURE_CACHE_BYTES,
+                                MarkerImageCache& imageCache = MarkerImageCache::shared());
+    ~MarkerTextureCache();
+
+    MarkerTextureCache(const MarkerTextureCache&) = delete;
+    MarkerTextureCache& operator=(const MarkerTextureCache&) = delete;
+
+    // Texture of the marker, see createMarkerTexture(). Valid until a later get() evicts it,
+    // so fetch every texture of a frame right before it's drawn.
+    GLuint get(const Marker& marker, int textureSize);
+
+    // Deletes every texture, the context has to be current
+    void clear();
+
+    std::size_t size() const;
+
+private:
+    LruCache<GLuint>    textures;
+    MarkerImageCache&   imageCache;
+};
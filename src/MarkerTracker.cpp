@@ -0,0 +1,140 @@
+#include "MarkerTracker.h"
+#include "SoftwareRendering.h"
+
+#include <algorithm>
+#include <cassert>
+
+
+MarkerTracker::MarkerTracker(const Camera& camera, const DetectorParams& detectorParams, const TrackerParams& trackerParams)
+    : detector(camera, detectorParams), params(trackerParams), framesSinceFull(0) {
+    assert(params.redetectInterval > 0);
+    assert(params.regionMargin >= 0.0);
+}
+
+
+void MarkerTracker::reset() {
+    tracks.clear();
+    regions.clear();
+}
+
+
+const std::vector<cv::Rect>& MarkerTracker::getRegions() const {
+    return regions;
+}
+
+
+MarkerTracker::TrackKey MarkerTracker::getKey(const Marker& marker) {
+    return (TrackKey(marker.numSquares) << 32) | marker.id;
+}
+
+
+cv::Rect MarkerTracker::getSearchRegion(const Marker& marker, const cv::Size& sceneSize) {
+    if (!projectMarker(detector.getCamera(), marker, corners))
+        return{};
+
+    cv::Rect box = cv::boundingRect(corners);
+
+    int marginX = int(box.width * params.regionMargin);
+    int marginY = int(box.height * params.regionMargin);
+
+    cv::Rect region{ box.x - marginX, box.y - marginY, box.width + 2 * marginX, box.height + 2 * marginY };
+
+    return region & cv::Rect{ 0, 0, sceneSize.width, sceneSize.height };
+}
+
+
+void MarkerTracker::addMarker(const MarkerScore& marker) {
+    auto key = getKey(marker.marker);
+    auto it = tracks.find(key);
+
+    if (it == tracks.end()) {
+        tracks.insert({ key, marker });
+    }
+    else if (marker.score > it->second.score) {
+        it->second = marker;
+    }
+}
+
+
+bool MarkerTracker::trackRegions(const cv::Mat& sceneRGB, RecognitionStats* stats) {
+    regions.clear();
+    expected.clear();
+
+    for (const auto& track : tracks) {
+        auto region = getSearchRegion(track.second.marker, sceneRGB.size());
+
+        if (region.area() == 0)
+            return false;
+
+        regions.push_back(region);
+        expected.push_back(track.first);
+    }
+
+    tracks.clear();
+
+    for (const auto& region : regions) {
+        for (const auto& marker : detector.detect(sceneRGB, region, stats ? &partStats : nullptr)) {
+            addMarker(marker);
+        }
+
+        if (stats) {
+            addStats(*stats, partStats);
+        }
+    }
+
+    // every tracked marker has to be found again, new ones only show up by chance
+    for (auto key : expected) {
+        if (tracks.find(key) == tracks.end())
+            return false;
+    }
+
+    return true;
+}
+
+
+const std::vector<MarkerScore>& MarkerTracker::track(const cv::Mat& sceneRGB, RecognitionStats* stats) {
+    if (stats) {
+        *stats = {};
+    }
+
+    StageTimer timer{ stats };
+
+    // every detect() below covers a region of this one frame
+    detector.nextFrame();
+
+    bool full = tracks.empty() || framesSinceFull >= params.redetectInterval;
+
+    if (!full) {
+        framesSinceFull++;
+
+        // a lost marker might be anywhere, search the whole frame right away
+        full = !trackRegions(sceneRGB, stats);
+    }
+
+    if (full) {
+        regions.clear();
+        tracks.clear();
+
+        cv::Rect scene{ 0, 0, sceneRGB.cols, sceneRGB.rows };
+
+        for (const auto& marker : detector.detect(sceneRGB, scene, stats ? &partStats : nullptr)) {
+            addMarker(marker);
+        }
+
+        if (stats) {
+            addStats(*stats, partStats);
+        }
+
+        framesSinceFull = 0;
+    }
+
+    markers.clear();
+
+    for (const auto& track : tracks) {
+        markers.push_back(track.second);
+    }
+
+    timer.stop();
+
+    return markers;
+}
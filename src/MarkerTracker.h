@@ -0,0 +1,63 @@
+#pragma once
+
+#include "Camera.h"
+#include "MarkerDetector.h"
+#include "Recognition.h"
+#include "Statistics.h"
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+
+struct TrackerParams {
+    int     redetectInterval    = 30;       // frames between full-frame detections
+    double  regionMargin        = 0.5;      // search region grows by this fraction of the predicted quad size
+};
+
+
+// MarkerDetector for video. Markers found in the previous frame are searched for only
+// around their projected last pose. The whole frame is searched every redetectInterval
+// frames, while nothing is tracked and right away when a tracked marker isn't found.
+class MarkerTracker {
+public:
+    explicit MarkerTracker(const Camera& camera, const DetectorParams& detectorParams = DetectorParams(),
+                           const TrackerParams& trackerParams = TrackerParams());
+
+    // Recognizes markers in the next frame, the result is valid until the next call
+    const std::vector<MarkerScore>& track(const cv::Mat& sceneRGB, RecognitionStats* stats = nullptr);
+
+    // Forget every track, the next frame is searched as a whole
+    void reset();
+
+    // Search regions of the last frame, empty after a full-frame detection
+    const std::vector<cv::Rect>& getRegions() const;
+
+private:
+    // Markers are told apart by their grid size and ID
+    typedef std::uint64_t TrackKey;
+
+    static TrackKey getKey(const Marker& marker);
+
+    // Predicted quad bounding box with the margin, empty if not in view
+    cv::Rect getSearchRegion(const Marker& marker, const cv::Size& sceneSize);
+
+    // Search every predicted region, false if a tracked marker wasn't found
+    bool trackRegions(const cv::Mat& sceneRGB, RecognitionStats* stats);
+
+    // Keep the best scoring marker of every key
+    void addMarker(const MarkerScore& marker);
+
+    MarkerDetector                      detector;
+    TrackerParams                       params;
+
+    std::map<TrackKey, MarkerScore>     tracks;
+    std::vector<MarkerScore>            markers;
+    std::vector<cv::Rect>               regions;
+    std::vector<TrackKey>               expected;
+    std::vector<cv::Point2f>            corners;
+    RecognitionStats                    partStats;
+
+    int                                 framesSinceFull;
+};
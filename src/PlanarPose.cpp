@@ -0,0 +1,373 @@
+#include "PlanarPose.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+
+// Square corner in the square plane, see PlanarPose
+cv::Vec3d getSquareCorner(int index, double squareSize) {
+    static const double signs[4][2] = { { -1.0, -1.0 }, { 1.0, -1.0 }, { 1.0, 1.0 }, { -1.0, 1.0 } };
+    double half = squareSize / 2.0;
+
+    return{ signs[index][0] * half, signs[index][1] * half, 0.0 };
+}
+
+
+// Quad corners and square corners of a pose problem, image points in normalized
+// camera coordinates (x / z, y / z) so the solver doesn't depend on the intrinsics
+struct SquareCorrespondences {
+    cv::Point2d     points[4];
+    cv::Vec3d       corners[4];
+
+    SquareCorrespondences(const Camera& camera, const std::vector<cv::Point2f>& quad, double squareSize) {
+        assert(quad.size() == 4);
+
+        for (int i = 0; i < 4; i++) {
+            points[i] = { (quad[i].x - camera.principalX) / camera.focalX, (quad[i].y - camera.principalY) / camera.focalY };
+            corners[i] = getSquareCorner(i, squareSize);
+        }
+    }
+};
+
+
+cv::Matx33d getRotationMatrix(const cv::Vec3d& rotationVec) {
+    double angle = cv::norm(rotationVec);
+
+    if (angle < POSE_EPSILON)
+        return cv::Matx33d::eye();
+
+    cv::Vec3d k = rotationVec * (1.0 / angle);
+
+    cv::Matx33d cross{
+        0.0,   -k[2],  k[1],
+        k[2],   0.0,  -k[0],
+       -k[1],   k[0],  0.0 };
+
+    return cv::Matx33d::eye() + cross * std::sin(angle) + cross * cross * (1.0 - std::cos(angle));
+}
+
+
+// Homography mapping the square plane onto the normalized image points, false if degenerate.
+// Unit square -> quad is solved in closed form (Heckbert 1989) and scaled to the side length.
+bool getSquareHomography(const SquareCorrespondences& c, double squareSize, cv::Matx33d& h) {
+    const auto* p = c.points;
+
+    double sx = p[0].x - p[1].x + p[2].x - p[3].x;
+    double sy = p[0].y - p[1].y + p[2].y - p[3].y;
+    double dx1 = p[1].x - p[2].x, dx2 = p[3].x - p[2].x;
+    double dy1 = p[1].y - p[2].y, dy2 = p[3].y - p[2].y;
+
+    double det = dx1 * dy2 - dx2 * dy1;
+
+    if (std::abs(det) < POSE_EPSILON)
+        return false;
+
+    double g = (sx * dy2 - sy * dx2) / det;
+    double k = (dx1 * sy - dy1 * sx) / det;
+
+    cv::Matx33d unitToQuad{
+        p[1].x - p[0].x + g * p[1].x,   p[3].x - p[0].x + k * p[3].x,   p[0].x,
+        p[1].y - p[0].y + g * p[1].y,   p[3].y - p[0].y + k * p[3].y,   p[0].y,
+        g,                              k,                              1.0 };
+
+    double scale = 1.0 / squareSize;
+
+    cv::Matx33d planeToUnit{
+        scale,  0.0,    0.5,
+        0.0,    scale,  0.5,
+        0.0,    0.0,    1.0 };
+
+    h = unitToQuad * planeToUnit;
+
+    // the square center must not map to infinity
+    if (std::abs(h(2, 2)) < POSE_EPSILON)
+        return false;
+
+    h = h * (1.0 / h(2, 2));
+    return true;
+}
+
+
+// The two rotations of the square plane matching the homography Jacobian at the square
+// center (IPPE). They mirror each other about the ray through the center.
+bool getPlaneRotations(const cv::Matx33d& h, cv::Matx33d rotations[2]) {
+    // image of the square center and the homography Jacobian there
+    double v0 = h(0, 2), v1 = h(1, 2);
+
+    double j00 = h(0, 0) - h(2, 0) * v0;
+    double j01 = h(0, 1) - h(2, 1) * v0;
+    double j10 = h(1, 0) - h(2, 0) * v1;
+    double j11 = h(1, 1) - h(2, 1) * v1;
+
+    // rotation taking the optical axis onto the ray through the center
+    double vNorm = std::sqrt(v0 * v0 + v1 * v1);
+    cv::Matx33d rv = cv::Matx33d::eye();
+
+    if (vNorm > POSE_EPSILON) {
+        rv = getRotationMatrix(cv::Vec3d{ -v1, v0, 0.0 } * (std::atan(vNorm) / vNorm));
+    }
+
+    // A = B^-1 * J, the upper 2x2 block of rv^T * R scaled by the inverse depth
+    double b00 = rv(0, 0) - v0 * rv(2, 0);
+    double b01 = rv(0, 1) - v0 * rv(2, 1);
+    double b10 = rv(1, 0) - v1 * rv(2, 0);
+    double b11 = rv(1, 1) - v1 * rv(2, 1);
+
+    double det = b00 * b11 - b01 * b10;
+
+    if (std::abs(det) < POSE_EPSILON)
+        return false;
+
+    double a00 = (b11 * j00 - b01 * j10) / det;
+    double a01 = (b11 * j01 - b01 * j11) / det;
+    double a10 = (b00 * j10 - b10 * j00) / det;
+    double a11 = (b00 * j11 - b10 * j01) / det;
+
+    // largest singular value of A
+    double aa00 = a00 * a00 + a01 * a01;
+    double aa01 = a00 * a10 + a01 * a11;
+    double aa11 = a10 * a10 + a11 * a11;
+    double halfDiff = (aa00 - aa11) / 2.0;
+    double gamma = std::sqrt((aa00 + aa11) / 2.0 + std::sqrt(halfDiff * halfDiff + aa01 * aa01));
+
+    if (gamma < POSE_EPSILON)
+        return false;
+
+    double r00 = a00 / gamma, r01 = a01 / gamma;
+    double r10 = a10 / gamma, r11 = a11 / gamma;
+
+    // complete the first two columns to unit length, keeping them orthogonal
+    double c0 = std::sqrt(std::max(1.0 - r00 * r00 - r10 * r10, 0.0));
+    double c1 = std::sqrt(std::max(1.0 - r01 * r01 - r11 * r11, 0.0));
+
+    if (r00 * r01 + r10 * r11 > 0.0) {
+        c1 = -c1;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        double sign = i == 0 ? 1.0 : -1.0;
+
+        cv::Vec3d x{ r00, r10, sign * c0 };
+        cv::Vec3d y{ r01, r11, sign * c1 };
+        cv::Vec3d z = x.cross(y);
+
+        cv::Matx33d local{
+            x[0], y[0], z[0],
+            x[1], y[1], z[1],
+            x[2], y[2], z[2] };
+
+        rotations[i] = rv * local;
+    }
+
+    return true;
+}
+
+
+// Least squares translation given the rotation. Every corner must lie on its image ray,
+// which is linear in the translation: [1 0 -u; 0 1 -v] * (R * X + t) = 0
+cv::Vec3d solveTranslation(const SquareCorrespondences& c, const cv::Matx33d& rotation) {
+    cv::Matx33d lhs = cv::Matx33d::zeros();
+    cv::Vec3d rhs;
+
+    for (int i = 0; i < 4; i++) {
+        double u = c.points[i].x, v = c.points[i].y;
+
+        cv::Matx33d normal{
+            1.0,    0.0,    -u,
+            0.0,    1.0,    -v,
+            -u,     -v,     u * u + v * v };
+
+        lhs += normal;
+        rhs -= normal * (rotation * c.corners[i]);
+    }
+
+    return lhs.solve(rhs, cv::DECOMP_LU);
+}
+
+
+// RMS reprojection error in pixels, infinity if a corner is behind the camera
+double getReprojectionError(const Camera& camera, const SquareCorrespondences& c, const cv::Matx33d& rotation, const cv::Vec3d& translation) {
+    double sum = 0.0;
+
+    for (int i = 0; i < 4; i++) {
+        cv::Vec3d p = rotation * c.corners[i] + translation;
+
+        if (p[2] < POSE_EPSILON)
+            return std::numeric_limits<double>::infinity();
+
+        double dx = (p[0] / p[2] - c.points[i].x) * camera.focalX;
+        double dy = (p[1] / p[2] - c.points[i].y) * camera.focalY;
+
+        sum += dx * dx + dy * dy;
+    }
+
+    return std::sqrt(sum / 4.0);
+}
+
+
+// Gauss-Newton on the pixel residuals. The rotation is updated by a small rotation
+// vector w applied on the left (R' = exp(w) * R), so the corner derivative is -[R * X]x.
+bool refineSquarePose(const Camera& camera, const SquareCorrespondences& c, int iterations, PlanarPose& pose) {
+    typedef cv::Matx<double, 6, 6> Matx66d;
+    typedef cv::Vec<double, 6> Vec6d;
+
+    double fx = camera.focalX, fy = camera.focalY;
+
+    for (int iteration = 0; iteration < iterations; iteration++) {
+        Matx66d jtj;
+        Vec6d jtr;
+
+        for (int i = 0; i < 4; i++) {
+            cv::Vec3d q = pose.R * c.corners[i];
+            cv::Vec3d p = q + pose.t;
+            double z = p[2];
+
+            double rx = (p[0] / z - c.points[i].x) * fx;
+            double ry = (p[1] / z - c.points[i].y) * fy;
+
+            // projection derivatives by the camera space point
+            double dx[3] = { fx / z, 0.0, -fx * p[0] / (z * z) };
+            double dy[3] = { 0.0, fy / z, -fy * p[1] / (z * z) };
+
+            // point derivatives by the rotation vector, -[q]x
+            double dw[3][3] = {
+                {  0.0,   q[2], -q[1] },
+                { -q[2],  0.0,   q[0] },
+                {  q[1], -q[0],  0.0  } };
+
+            double jx[6], jy[6];
+
+            for (int k = 0; k < 3; k++) {
+                jx[k] = dx[0] * dw[0][k] + dx[1] * dw[1][k] + dx[2] * dw[2][k];
+                jy[k] = dy[0] * dw[0][k] + dy[1] * dw[1][k] + dy[2] * dw[2][k];
+                jx[k + 3] = dx[k];
+                jy[k + 3] = dy[k];
+            }
+
+            for (int a = 0; a < 6; a++) {
+                jtr[a] += jx[a] * rx + jy[a] * ry;
+
+                for (int b = 0; b < 6; b++) {
+                    jtj(a, b) += jx[a] * jx[b] + jy[a] * jy[b];
+                }
+            }
+        }
+
+        Vec6d step = jtj.solve(jtr, cv::DECOMP_CHOLESKY);
+
+        PlanarPose updated;
+        updated.R = getRotationMatrix(cv::Vec3d{ -step[0], -step[1], -step[2] }) * pose.R;
+        updated.t = pose.t - cv::Vec3d{ step[3], step[4], step[5] };
+        updated.error = getReprojectionError(camera, c, updated.R, updated.t);
+
+        // already at the minimum
+        if (!(updated.error < pose.error))
+            return true;
+
+        double improvement = pose.error - updated.error;
+        pose = updated;
+
+        if (improvement < POSE_MIN_IMPROVEMENT)
+            return true;
+    }
+
+    return false;
+}
+
+
+bool refineSquarePose(const Camera& camera, const std::vector<cv::Point2f>& quad, double squareSize, int iterations, PlanarPose& pose) {
+    SquareCorrespondences c{ camera, quad, squareSize };
+
+    pose.error = getReprojectionError(camera, c, pose.R, pose.t);
+
+    if (!std::isfinite(pose.error))
+        return false;
+
+    return refineSquarePose(camera, c, iterations, pose);
+}
+
+
+// Frobenius product of two rotations, the larger the closer they are (3 for equal ones)
+double getRotationSimilarity(const cv::Matx33d& a, const cv::Matx33d& b) {
+    double sum = 0.0;
+
+    for (int i = 0; i < 9; i++) {
+        sum += a.val[i] * b.val[i];
+    }
+
+    return sum;
+}
+
+
+bool warmStartSquarePose(const Camera& camera, const std::vector<cv::Point2f>& quad, double squareSize,
+                         const PlanarPose& previous, PlanarPose& pose) {
+    pose = previous;
+    return refineSquarePose(camera, quad, squareSize, WARM_START_ITERATIONS, pose) && pose.error <= WARM_START_MAX_ERROR;
+}
+
+
+const PlanarPose& selectSquarePose(const PlanarPoseSolutions& solutions, const PlanarPose* previous) {
+    assert(solutions.count > 0);
+
+    const auto& best = solutions.poses[0];
+    const auto& other = solutions.poses[1];
+
+    bool ambiguous = solutions.count == 2 && other.error <= best.error * POSE_AMBIGUITY_RATIO;
+
+    if (previous && ambiguous && getRotationSimilarity(other.R, previous->R) > getRotationSimilarity(best.R, previous->R))
+        return other;
+
+    return best;
+}
+
+
+bool solveSquarePose(const Camera& camera, const std::vector<cv::Point2f>& quad, double squareSize,
+                     const PlanarPose& previous, PlanarPose& pose) {
+    if (warmStartSquarePose(camera, quad, squareSize, previous, pose))
+        return true;
+
+    // cold solve
+    PlanarPoseSolutions solutions;
+
+    if (solveSquarePose(camera, quad, squareSize, POSE_REFINE_ITERATIONS, solutions) == 0)
+        return false;
+
+    pose = selectSquarePose(solutions, &previous);
+    return true;
+}
+
+
+int solveSquarePose(const Camera& camera, const std::vector<cv::Point2f>& quad, double squareSize,
+                    int refineIterations, PlanarPoseSolutions& solutions) {
+    assert(squareSize > 0.0 && refineIterations >= 0);
+
+    SquareCorrespondences c{ camera, quad, squareSize };
+    cv::Matx33d h, rotations[2];
+
+    solutions.count = 0;
+
+    if (!getSquareHomography(c, squareSize, h) || !getPlaneRotations(h, rotations))
+        return 0;
+
+    for (const auto& rotation : rotations) {
+        PlanarPose pose;
+        pose.R = rotation;
+        pose.t = solveTranslation(c, rotation);
+        pose.error = getReprojectionError(camera, c, pose.R, pose.t);
+
+        // the mirrored pose can put a corner behind the camera
+        if (!std::isfinite(pose.error))
+            continue;
+
+        refineSquarePose(camera, c, refineIterations, pose);
+        solutions.poses[solutions.count++] = pose;
+    }
+
+    if (solutions.count == 2 && solutions.poses[1].error < solutions.poses[0].error) {
+        std::swap(solutions.poses[0], solutions.poses[1]);
+    }
+
+    return solutions.count;
+}
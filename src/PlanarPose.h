@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Camera.h"
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+
+// Pose of a square marker from its 4 image corners without cv::solvePnP(). A homography
+// is decomposed in closed form (IPPE, Collins & Bartoli 2014) into the two poses a planar
+// target can't be told apart between, then each is refined with a few Gauss-Newton steps.
+// Everything lives on the stack in fixed-size cv::Matx types.
+
+
+const double POSE_EPSILON            = 1e-12;
+const int    POSE_REFINE_ITERATIONS  = 3;
+const double POSE_MIN_IMPROVEMENT    = 1e-3;     // pixels of reprojection error, a smaller one ends the refinement
+const int    WARM_START_ITERATIONS   = 5;
+const double WARM_START_MAX_ERROR    = 1.0;      // pixels, a warm start above falls back to the closed form
+const double POSE_AMBIGUITY_RATIO    = 2.0;      // two solutions are both plausible if their errors are within it
+
+
+// Rotation and translation in OpenCV camera space (x right, y down, z forward).
+// The square corners are (-s/2, -s/2, 0), (s/2, -s/2, 0), (s/2, s/2, 0), (-s/2, s/2, 0)
+// for a side length s, in the order of a candidate quad.
+struct PlanarPose {
+    cv::Matx33d     R;
+    cv::Vec3d       t;
+    double          error = 0.0;    // RMS reprojection error in pixels
+};
+
+
+// Both poses of a square, the one with the smaller reprojection error first
+struct PlanarPoseSolutions {
+    PlanarPose      poses[2];
+    int             count = 0;      // 0 for a degenerate quad, 1 if the other pose is behind the camera
+};
+
+
+// Solve the pose of a square with the given side length seen as quad,
+// refineIterations can be 0 to keep the closed-form solutions. Returns solutions.count.
+int solveSquarePose(const Camera& camera, const std::vector<cv::Point2f>& quad, double squareSize,
+                    int refineIterations, PlanarPoseSolutions& solutions);
+
+// Pose of a square that had the pose previous in the last frame. Refinement starts from it and
+// falls back to the closed form unless it converges below WARM_START_MAX_ERROR. The closed form
+// keeps the solution closer to previous if both are plausible, so the pose doesn't flip between them.
+// Returns false if there is no pose.
+bool solveSquarePose(const Camera& camera, const std::vector<cv::Point2f>& quad, double squareSize,
+                     const PlanarPose& previous, PlanarPose& pose);
+
+// The warm start of the above alone, false if it didn't converge below WARM_START_MAX_ERROR
+bool warmStartSquarePose(const Camera& camera, const std::vector<cv::Point2f>& quad, double squareSize,
+                         const PlanarPose& previous, PlanarPose& pose);
+
+// The solution to keep, the better one unless both are plausible and the other
+// is closer to previous. solutions.count must not be 0, previous may be nullptr.
+const PlanarPose& selectSquarePose(const PlanarPoseSolutions& solutions, const PlanarPose* previous);
+
+// Gauss-Newton steps minimizing the reprojection error. Returns true if they converged,
+// i.e. a step improved the error by less than POSE_MIN_IMPROVEMENT before running out.
+bool refineSquarePose(const Camera& camera, const std::vector<cv::Point2f>& quad, double squareSize,
+                      int iterations, PlanarPose& pose);
+
+// Rotation matrix of a rotation vector (axis * angle in radians)
+cv::Matx33d getRotationMatrix(const cv::Vec3d& rotationVec);
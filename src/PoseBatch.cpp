@@ -0,0 +1,348 @@
+#include "PoseBatch.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <functional>
+#include <limits>
+
+
+// Square corner signs, see PlanarPose
+const double CORNER_X[4] = { -1.0, 1.0, 1.0, -1.0 };
+const double CORNER_Y[4] = { -1.0, -1.0, 1.0, 1.0 };
+
+
+SquarePoseBatch::SquarePoseBatch(const Camera& camera)
+    : camera(camera), invFocalX(1.0 / camera.focalX), invFocalY(1.0 / camera.focalY), count(0) {
+}
+
+
+void SquarePoseBatch::setCamera(const Camera& camera) {
+    bool changed =
+        camera.focalX != this->camera.focalX || camera.focalY != this->camera.focalY ||
+        camera.principalX != this->camera.principalX || camera.principalY != this->camera.principalY;
+
+    if (!changed)
+        return;
+
+    assert(count == 0 && "Queued squares were normalized with the old camera");
+
+    this->camera = camera;
+    invFocalX = 1.0 / camera.focalX;
+    invFocalY = 1.0 / camera.focalY;
+}
+
+
+void SquarePoseBatch::clear() {
+    count = 0;
+}
+
+
+void SquarePoseBatch::add(const std::vector<cv::Point2f>& quad) {
+    assert(quad.size() == 4);
+
+    std::size_t block = count / POSE_BATCH_WIDTH;
+    std::size_t lane = count % POSE_BATCH_WIDTH;
+
+    if (block == blocks.size()) {
+        blocks.emplace_back();
+    }
+
+    for (int i = 0; i < 4; i++) {
+        blocks[block].u[i][lane] = (quad[i].x - camera.principalX) * invFocalX;
+        blocks[block].v[i][lane] = (quad[i].y - camera.principalY) * invFocalY;
+    }
+
+    if (count == quads.size()) {
+        quads.emplace_back();
+        solutions.emplace_back();
+    }
+
+    quads[count].assign(std::begin(quad), std::end(quad));
+    count++;
+}
+
+
+std::size_t SquarePoseBatch::size() const {
+    return count;
+}
+
+
+const PlanarPoseSolutions& SquarePoseBatch::getSolutions(std::size_t index) const {
+    assert(index < count);
+    return solutions[index];
+}
+
+
+// Unit square -> quad in closed form (Heckbert 1989), scaled to the side length
+// and normalized to h[8] == 1, see getSquareHomography()
+void SquarePoseBatch::solveHomographies(Lanes& lanes, double squareSize) const {
+    double scale = 1.0 / squareSize;
+
+    for (int k = 0; k < POSE_BATCH_WIDTH; k++) {
+        double x0 = lanes.u[0][k], x1 = lanes.u[1][k], x2 = lanes.u[2][k], x3 = lanes.u[3][k];
+        double y0 = lanes.v[0][k], y1 = lanes.v[1][k], y2 = lanes.v[2][k], y3 = lanes.v[3][k];
+
+        double sx = x0 - x1 + x2 - x3;
+        double sy = y0 - y1 + y2 - y3;
+        double dx1 = x1 - x2, dx2 = x3 - x2;
+        double dy1 = y1 - y2, dy2 = y3 - y2;
+
+        double det = dx1 * dy2 - dx2 * dy1;
+        bool valid = std::abs(det) >= POSE_EPSILON;
+        double invDet = 1.0 / (valid ? det : 1.0);
+
+        double g = (sx * dy2 - sy * dx2) * invDet;
+        double h = (dx1 * sy - dy1 * sx) * invDet;
+
+        double a = x1 - x0 + g * x1, b = x3 - x0 + h * x3;
+        double d = y1 - y0 + g * y1, e = y3 - y0 + h * y3;
+
+        // the square center must not map to infinity
+        double center = 0.5 * (g + h) + 1.0;
+        valid = valid && std::abs(center) >= POSE_EPSILON;
+        double invCenter = 1.0 / (valid ? center : 1.0);
+
+        lanes.h[0][k] = a * scale * invCenter;
+        lanes.h[1][k] = b * scale * invCenter;
+        lanes.h[2][k] = (0.5 * (a + b) + x0) * invCenter;
+        lanes.h[3][k] = d * scale * invCenter;
+        lanes.h[4][k] = e * scale * invCenter;
+        lanes.h[5][k] = (0.5 * (d + e) + y0) * invCenter;
+        lanes.h[6][k] = g * scale * invCenter;
+        lanes.h[7][k] = h * scale * invCenter;
+        lanes.h[8][k] = 1.0;
+        lanes.valid[k] = valid;
+    }
+}
+
+
+// IPPE decomposition of the homographies, see getPlaneRotations(). The rotation taking
+// the optical axis onto the center ray is built without trigonometry so the loop vectorizes.
+void SquarePoseBatch::solveRotations(Lanes& lanes) const {
+    for (int k = 0; k < POSE_BATCH_WIDTH; k++) {
+        double v0 = lanes.h[2][k], v1 = lanes.h[5][k];
+
+        double j00 = lanes.h[0][k] - lanes.h[6][k] * v0;
+        double j01 = lanes.h[1][k] - lanes.h[7][k] * v0;
+        double j10 = lanes.h[3][k] - lanes.h[6][k] * v1;
+        double j11 = lanes.h[4][k] - lanes.h[7][k] * v1;
+
+        // rv = I + [a]x + [a]x^2 / (1 + cosine), a = z x p for the unit center ray p
+        double cosine = 1.0 / std::sqrt(1.0 + v0 * v0 + v1 * v1);
+        double a0 = -v1 * cosine, a1 = v0 * cosine;
+        double f = 1.0 / (1.0 + cosine);
+
+        double rv[9] = {
+            1.0 - f * a1 * a1,  f * a0 * a1,        a1,
+            f * a0 * a1,        1.0 - f * a0 * a0,  -a0,
+            -a1,                a0,                 1.0 - f * (a0 * a0 + a1 * a1) };
+
+        double b00 = rv[0] - v0 * rv[6];
+        double b01 = rv[1] - v0 * rv[7];
+        double b10 = rv[3] - v1 * rv[6];
+        double b11 = rv[4] - v1 * rv[7];
+
+        double det = b00 * b11 - b01 * b10;
+        bool valid = lanes.valid[k] && std::abs(det) >= POSE_EPSILON;
+        double invDet = 1.0 / (valid ? det : 1.0);
+
+        double a00 = (b11 * j00 - b01 * j10) * invDet;
+        double a01 = (b11 * j01 - b01 * j11) * invDet;
+        double a10 = (b00 * j10 - b10 * j00) * invDet;
+        double a11 = (b00 * j11 - b10 * j01) * invDet;
+
+        double aa00 = a00 * a00 + a01 * a01;
+        double aa01 = a00 * a10 + a01 * a11;
+        double aa11 = a10 * a10 + a11 * a11;
+        double halfDiff = (aa00 - aa11) / 2.0;
+        double gamma = std::sqrt((aa00 + aa11) / 2.0 + std::sqrt(halfDiff * halfDiff + aa01 * aa01));
+
+        valid = valid && gamma >= POSE_EPSILON;
+        double invGamma = 1.0 / (valid ? gamma : 1.0);
+
+        double r00 = a00 * invGamma, r01 = a01 * invGamma;
+        double r10 = a10 * invGamma, r11 = a11 * invGamma;
+
+        double c0 = std::sqrt(std::max(1.0 - r00 * r00 - r10 * r10, 0.0));
+        double c1 = std::sqrt(std::max(1.0 - r01 * r01 - r11 * r11, 0.0));
+        c1 = r00 * r01 + r10 * r11 > 0.0 ? -c1 : c1;
+
+        for (int s = 0; s < 2; s++) {
+            double x2 = s == 0 ? c0 : -c0;
+            double y2 = s == 0 ? c1 : -c1;
+
+            // columns x, y and z = x cross y of the rotation in the center ray frame
+            double local[9] = {
+                r00,    r01,    r10 * y2 - x2 * r11,
+                r10,    r11,    x2 * r01 - r00 * y2,
+                x2,     y2,     r00 * r11 - r10 * r01 };
+
+            for (int i = 0; i < 3; i++) {
+                for (int j = 0; j < 3; j++) {
+                    lanes.r[s][i * 3 + j][k] = rv[i * 3] * local[j] + rv[i * 3 + 1] * local[3 + j] + rv[i * 3 + 2] * local[6 + j];
+                }
+            }
+        }
+
+        lanes.valid[k] = valid;
+    }
+}
+
+
+// Least squares translations, see solveTranslation(). The normal equations
+// only depend on the image points, so both solutions share their inverse.
+void SquarePoseBatch::solveTranslations(Lanes& lanes, double squareSize) const {
+    double half = squareSize / 2.0;
+
+    for (int k = 0; k < POSE_BATCH_WIDTH; k++) {
+        double su = 0.0, sv = 0.0, suv = 0.0;
+
+        for (int i = 0; i < 4; i++) {
+            double u = lanes.u[i][k], v = lanes.v[i][k];
+
+            su += u;
+            sv += v;
+            suv += u * u + v * v;
+        }
+
+        // symmetric [4 0 -su; 0 4 -sv; -su -sv suv], inverted through its adjugate
+        double m00 = 4.0, m02 = -su, m11 = 4.0, m12 = -sv, m22 = suv;
+
+        double c00 = m11 * m22 - m12 * m12;
+        double c01 = m02 * m12;
+        double c02 = -m02 * m11;
+        double c11 = m00 * m22 - m02 * m02;
+        double c12 = -m00 * m12;
+        double c22 = m00 * m11;
+
+        double det = m00 * c00 + m02 * c02;
+        bool valid = lanes.valid[k] && std::abs(det) >= POSE_EPSILON;
+        double invDet = 1.0 / (valid ? det : 1.0);
+
+        for (int s = 0; s < 2; s++) {
+            double rhs0 = 0.0, rhs1 = 0.0, rhs2 = 0.0;
+
+            for (int i = 0; i < 4; i++) {
+                double x = CORNER_X[i] * half, y = CORNER_Y[i] * half;
+                double u = lanes.u[i][k], v = lanes.v[i][k];
+
+                double q0 = lanes.r[s][0][k] * x + lanes.r[s][1][k] * y;
+                double q1 = lanes.r[s][3][k] * x + lanes.r[s][4][k] * y;
+                double q2 = lanes.r[s][6][k] * x + lanes.r[s][7][k] * y;
+
+                rhs0 -= q0 - u * q2;
+                rhs1 -= q1 - v * q2;
+                rhs2 -= (u * u + v * v) * q2 - u * q0 - v * q1;
+            }
+
+            lanes.t[s][0][k] = (c00 * rhs0 + c01 * rhs1 + c02 * rhs2) * invDet;
+            lanes.t[s][1][k] = (c01 * rhs0 + c11 * rhs1 + c12 * rhs2) * invDet;
+            lanes.t[s][2][k] = (c02 * rhs0 + c12 * rhs1 + c22 * rhs2) * invDet;
+        }
+
+        lanes.valid[k] = valid;
+    }
+}
+
+
+// RMS reprojection errors in pixels, see getReprojectionError()
+void SquarePoseBatch::solveErrors(Lanes& lanes, double squareSize) const {
+    const double infinity = std::numeric_limits<double>::infinity();
+    double half = squareSize / 2.0;
+
+    for (int s = 0; s < 2; s++) {
+        for (int k = 0; k < POSE_BATCH_WIDTH; k++) {
+            bool inFront = true;
+            double sum = 0.0;
+
+            for (int i = 0; i < 4; i++) {
+                double x = CORNER_X[i] * half, y = CORNER_Y[i] * half;
+
+                double px = lanes.r[s][0][k] * x + lanes.r[s][1][k] * y + lanes.t[s][0][k];
+                double py = lanes.r[s][3][k] * x + lanes.r[s][4][k] * y + lanes.t[s][1][k];
+                double pz = lanes.r[s][6][k] * x + lanes.r[s][7][k] * y + lanes.t[s][2][k];
+
+                inFront = inFront && pz >= POSE_EPSILON;
+                double invZ = 1.0 / (pz >= POSE_EPSILON ? pz : 1.0);
+
+                double dx = (px * invZ - lanes.u[i][k]) * camera.focalX;
+                double dy = (py * invZ - lanes.v[i][k]) * camera.focalY;
+
+                sum += dx * dx + dy * dy;
+            }
+
+            lanes.error[s][k] = lanes.valid[k] && inFront ? std::sqrt(sum / 4.0) : infinity;
+        }
+    }
+}
+
+
+void SquarePoseBatch::solve(double squareSize, int refineIterations, ThreadPool* pool) {
+    assert(squareSize > 0.0 && refineIterations >= 0);
+
+    std::size_t numBlocks = (count + POSE_BATCH_WIDTH - 1) / POSE_BATCH_WIDTH;
+
+    auto solveBlock = [&](std::size_t block) {
+        this->solveBlock(block, squareSize, refineIterations);
+    };
+
+    if (pool && numBlocks > 1) {
+        // by reference, so std::function doesn't allocate
+        pool->parallelFor(numBlocks, std::ref(solveBlock));
+    }
+    else {
+        for (std::size_t block = 0; block < numBlocks; block++) {
+            solveBlock(block);
+        }
+    }
+}
+
+
+void SquarePoseBatch::solveBlock(std::size_t block, double squareSize, int refineIterations) {
+    std::size_t first = block * POSE_BATCH_WIDTH;
+    auto& lanes = blocks[block];
+    int numLanes = int(std::min<std::size_t>(POSE_BATCH_WIDTH, count - first));
+
+    // unused lanes of the last block repeat its first square
+    for (int k = numLanes; k < POSE_BATCH_WIDTH; k++) {
+        for (int i = 0; i < 4; i++) {
+            lanes.u[i][k] = lanes.u[i][0];
+            lanes.v[i][k] = lanes.v[i][0];
+        }
+    }
+
+    solveHomographies(lanes, squareSize);
+    solveRotations(lanes);
+    solveTranslations(lanes, squareSize);
+    solveErrors(lanes, squareSize);
+
+    for (int k = 0; k < numLanes; k++) {
+        auto& result = solutions[first + k];
+        result.count = 0;
+
+        for (int s = 0; s < 2; s++) {
+            // the mirrored pose can put a corner behind the camera
+            if (!std::isfinite(lanes.error[s][k]))
+                continue;
+
+            PlanarPose pose;
+
+            for (int i = 0; i < 9; i++) {
+                pose.R.val[i] = lanes.r[s][i][k];
+            }
+
+            pose.t = { lanes.t[s][0][k], lanes.t[s][1][k], lanes.t[s][2][k] };
+            pose.error = lanes.error[s][k];
+
+            if (refineIterations > 0) {
+                refineSquarePose(camera, quads[first + k], squareSize, refineIterations, pose);
+            }
+            result.poses[result.count++] = pose;
+        }
+
+        if (result.count == 2 && result.poses[1].error < result.poses[0].error) {
+            std::swap(result.poses[0], result.poses[1]);
+        }
+    }
+}
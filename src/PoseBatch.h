@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Camera.h"
+#include "PlanarPose.h"
+#include "ThreadPool.h"
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+
+const int POSE_BATCH_WIDTH = 8;     // squares solved side by side, a multiple of the SIMD width
+
+
+// Closed-form poses of every square of a frame at once. Squares are grouped into blocks
+// of POSE_BATCH_WIDTH stored as structure of arrays, one lane per square, and every step
+// of the solver is a branch-free loop over the lanes the compiler can vectorize.
+// The Gauss-Newton refinement then runs on each solution separately. Blocks are
+// independent, so they can be solved on a thread pool.
+// Buffers are kept between frames, so a batch that is reused doesn't reallocate them.
+class SquarePoseBatch {
+public:
+    explicit SquarePoseBatch(const Camera& camera = Camera());
+
+    // Intrinsics-derived constants are recomputed only if the camera changed
+    void setCamera(const Camera& camera);
+
+    void clear();
+
+    // Queue a square for the next solve(), index is the order of add() calls
+    void add(const std::vector<cv::Point2f>& quad);
+
+    // Solve every queued square, see solveSquarePose(). Blocks go through pool->parallelFor()
+    // if given, otherwise they are solved on the calling thread.
+    void solve(double squareSize, int refineIterations, ThreadPool* pool = nullptr);
+
+    std::size_t size() const;
+
+    const PlanarPoseSolutions& getSolutions(std::size_t index) const;
+
+private:
+    // POSE_BATCH_WIDTH squares, [...][lane]
+    struct Lanes {
+        double  u[4][POSE_BATCH_WIDTH];             // normalized corner coordinates
+        double  v[4][POSE_BATCH_WIDTH];
+        double  h[9][POSE_BATCH_WIDTH];             // square plane -> normalized image homography
+        double  r[2][9][POSE_BATCH_WIDTH];          // rotations of both solutions, row-major
+        double  t[2][3][POSE_BATCH_WIDTH];
+        double  error[2][POSE_BATCH_WIDTH];         // infinity for a degenerate square or one behind the camera
+        bool    valid[POSE_BATCH_WIDTH];            // false for a degenerate square
+    };
+
+    // Closed form and refinement of the squares of one block
+    void solveBlock(std::size_t block, double squareSize, int refineIterations);
+
+    void solveHomographies(Lanes& lanes, double squareSize) const;
+    void solveRotations(Lanes& lanes) const;
+    void solveTranslations(Lanes& lanes, double squareSize) const;
+    void solveErrors(Lanes& lanes, double squareSize) const;
+
+    Camera                                  camera;
+    double                                  invFocalX;
+    double                                  invFocalY;
+
+    std::vector<Lanes>                      blocks;
+    std::vector<std::vector<cv::Point2f>>   quads;          // pixels, for the refinement
+    std::vector<PlanarPoseSolutions>        solutions;
+    std::size_t                             count;
+};
@@ -0,0 +1,43 @@
+#include "PoseCache.h"
+
+#include <cassert>
+
+
+PoseCache::PoseCache(int maxAge) : maxAge(maxAge), frame(0) {
+    assert(maxAge > 0);
+}
+
+
+PoseCache::Key PoseCache::getKey(int numSquares, std::uint32_t id) {
+    return (Key(numSquares) << 32) | id;
+}
+
+
+const PlanarPose* PoseCache::find(Key key) const {
+    auto it = entries.find(key);
+    return it != entries.end() ? &it->second.pose : nullptr;
+}
+
+
+void PoseCache::update(Key key, const PlanarPose& pose) {
+    entries[key] = { pose, frame };
+}
+
+
+void PoseCache::nextFrame() {
+    frame++;
+
+    for (auto it = entries.begin(); it != entries.end();) {
+        if (frame - it->second.frame > maxAge) {
+            it = entries.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+
+void PoseCache::clear() {
+    entries.clear();
+}
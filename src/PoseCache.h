@@ -0,0 +1,42 @@
+#pragma once
+
+#include "PlanarPose.h"
+
+#include <cstdint>
+#include <map>
+
+
+const int POSE_CACHE_MAX_AGE = 30;      // frames a pose is kept without the marker being seen
+
+
+// Last camera space pose of every recently seen marker, told apart by grid size and ID.
+// find() may be called from many threads as long as nothing modifies the cache meanwhile.
+class PoseCache {
+public:
+    typedef std::uint64_t Key;
+
+    explicit PoseCache(int maxAge = POSE_CACHE_MAX_AGE);
+
+    static Key getKey(int numSquares, std::uint32_t id);
+
+    // Pose of the marker in an earlier frame, nullptr if it wasn't seen recently
+    const PlanarPose* find(Key key) const;
+
+    // Store the pose of the current frame
+    void update(Key key, const PlanarPose& pose);
+
+    // Start the next frame, forgets poses not updated for maxAge frames
+    void nextFrame();
+
+    void clear();
+
+private:
+    struct Entry {
+        PlanarPose  pose;
+        int         frame;      // last update
+    };
+
+    std::map<Key, Entry>    entries;
+    int                     maxAge;
+    int                     frame;
+};
@@ -0,0 +1,86 @@
+#include "PoseSweeps.h"
+
+#include <cassert>
+
+
+// Evenly spaced value i of steps over [min, max], the middle one for a single step
+double sweepValue(double min, double max, int i, int steps) {
+    return steps > 1 ? min + (max - min) * i / (steps - 1) : (min + max) / 2.0;
+}
+
+
+MarkerFrames getTranslationSweep(const Marker& marker, double maxX, double maxY, int steps) {
+    assert(steps > 0);
+
+    MarkerFrames frames;
+    frames.reserve(steps * steps);
+
+    for (int row = 0; row < steps; row++) {
+        for (int col = 0; col < steps; col++) {
+            Marker moved = marker;
+            moved.t.x = sweepValue(-maxX, maxX, col, steps);
+            moved.t.y = sweepValue(maxY, -maxY, row, steps);
+
+            frames.push_back({ moved });
+        }
+    }
+
+    return frames;
+}
+
+
+MarkerFrames getRotationSweep(const Marker& marker, int axis, double minAngle, double maxAngle, int steps) {
+    assert(axis >= 0 && axis < 3);
+    assert(steps > 0);
+
+    MarkerFrames frames;
+    frames.reserve(steps);
+
+    for (int i = 0; i < steps; i++) {
+        Marker rotated = marker;
+        double angle = sweepValue(minAngle, maxAngle, i, steps);
+
+        if (axis == 0)      rotated.r.ox = angle;
+        else if (axis == 1) rotated.r.oy = angle;
+        else                rotated.r.oz = angle;
+
+        frames.push_back({ rotated });
+    }
+
+    return frames;
+}
+
+
+MarkerFrames getDistanceSweep(const Marker& marker, double minDistance, double maxDistance, int steps) {
+    assert(minDistance > 0.0 && steps > 0);
+
+    MarkerFrames frames;
+    frames.reserve(steps);
+
+    for (int i = 0; i < steps; i++) {
+        Marker moved = marker;
+        moved.t.z = -sweepValue(minDistance, maxDistance, i, steps);
+
+        frames.push_back({ moved });
+    }
+
+    return frames;
+}
+
+
+MarkerFrames getBenchmarkSweeps(const Marker& marker, int steps) {
+    MarkerFrames frames;
+
+    auto append = [&frames](const MarkerFrames& sweep) {
+        frames.insert(frames.end(), sweep.begin(), sweep.end());
+    };
+
+    // angles stay within (-90; 90) except around OZ, which covers (-180; 180] once
+    append(getTranslationSweep(marker, 1.5, 1.0, steps));
+    append(getRotationSweep(marker, 0, -80.0, 80.0, steps));
+    append(getRotationSweep(marker, 1, -80.0, 80.0, steps));
+    append(getRotationSweep(marker, 2, -180.0 + 360.0 / steps, 180.0, steps));
+    append(getDistanceSweep(marker, 1.0, 10.0, steps));
+
+    return frames;
+}
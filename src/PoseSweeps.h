@@ -0,0 +1,24 @@
+#pragma once
+
+#include "Marker.h"
+
+#include <vector>
+
+
+// Frames of a synthetic dataset, the markers of every frame. Each sweep moves a single
+// marker away from its start pose along one parameter at a time, like the benchmark plots.
+typedef std::vector<std::vector<Marker>> MarkerFrames;
+
+
+// steps*steps frames with x and y on a grid over [-maxX, maxX] x [-maxY, maxY]
+MarkerFrames getTranslationSweep(const Marker& marker, double maxX, double maxY, int steps);
+
+// steps frames rotated around OX, OY or OZ (axis 0, 1 or 2) from minAngle to maxAngle degrees
+MarkerFrames getRotationSweep(const Marker& marker, int axis, double minAngle, double maxAngle, int steps);
+
+// steps frames from minDistance to maxDistance in front of the camera (z = -distance)
+MarkerFrames getDistanceSweep(const Marker& marker, double minDistance, double maxDistance, int steps);
+
+// All of the above as in the benchmark plots: a translation grid and the rotations at marker.t,
+// then the distance sweep, for a camera seeing at least +-1.5 by +-1.0 at z = -3.0
+MarkerFrames getBenchmarkSweeps(const Marker& marker, int steps);
@@ -4,10 +4,23 @@
 #include "Marker.h"
 #include "Rendering.h"
 #include "Recognition.h"
+#include "MarkerDetector.h"
+#include "MarkerTextureCache.h"
+#include "SceneRenderer.h"
+#include "StreamingDetector.h"
+#include "Statistics.h"
 #include "Util.h"
 
 #include <GL/freeglut.h>
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <deque>
 #include <iomanip>
+#include <memory>
+#include <random>
+#include <thread>
 
 
 const double NEAR_PLANE     = 0.1;
@@ -18,21 +31,45 @@ const double ROTATE_ANGLE   = 10.0;
 
 const int    TEXTURE_SIZE   = 256;
 
+const int    STATS_DUMP_INTERVAL = 100;     // frames
+
+const int    LOAD_TEST_NUM_SQUARES  = 4;     // 12 ID bits, enough for distinct IDs
+const double LOAD_TEST_SPACING      = 1.5;   // marker sizes between grid neighbours
+const double LOAD_TEST_MAX_ANGLE    = 30.0;  // degrees of OX and OY tilt
+
+const std::chrono::milliseconds IDLE_SLEEP{ 1 };
+const std::chrono::milliseconds READBACK_IDLE_TIMEOUT{ 100 };   // without newer frames the last ones are read then
+
 
 Camera camera;
 Marker marker;
 Transformation origin;
-GLuint markerTexture;
+std::unique_ptr<MarkerTextureCache> textureCache;
+std::unique_ptr<StreamingDetector> detector;
+std::unique_ptr<ViewReadback> readback;
+RollingStats recognitionStats;
+
+// markers of the frames queued for readback
+std::deque<Marker> renderedMarkers;
+std::chrono::steady_clock::time_point lastQueued;
+
+// markers of the submitted frames that have no result yet
+std::deque<std::pair<std::uint64_t, Marker>> pendingFrames;
+StreamingResult result;
 
 
 // GLUT handlers
 void display();
+void idleHandler();
 void reshapeHandler(GLsizei width, GLsizei height);
 void specialKeysHandler(int key, int, int);
 void normalKeysHandler(unsigned char key, int, int);
 
 void compareMarkers(const Marker& marker, const Marker& recognized, double score);
 
+// Hand the oldest frame read back to the detector
+void submitReadback();
+
 
 
 void initializeGL(const Camera& camera, const Marker& marker) {
@@ -41,6 +78,7 @@ void initializeGL(const Camera& camera, const Marker& marker) {
     ::marker = marker;
 
     ::origin = { marker.t, marker.r };
+    ::detector.reset(new StreamingDetector(camera));
 
     // GLUT setup
     glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH | GLUT_MULTISAMPLE);
@@ -52,6 +90,7 @@ void initializeGL(const Camera& camera, const Marker& marker) {
 
     // handlers
     glutDisplayFunc(display);
+    glutIdleFunc(idleHandler);
     glutReshapeFunc(reshapeHandler);
     glutKeyboardFunc(normalKeysHandler);
     glutSpecialFunc(specialKeysHandler);
@@ -71,12 +110,17 @@ void initializeGL(const Camera& camera, const Marker& marker) {
     loadPerspectiveMatrix(camera, NEAR_PLANE, FAR_PLANE);
     glMatrixMode(GL_MODELVIEW);
 
-    ::markerTexture = createMarkerTexture(marker, TEXTURE_SIZE);
+    ::textureCache.reset(new MarkerTextureCache());
+    ::readback.reset(new ViewReadback(camera.imageWidth, camera.imageHeight));
 }
 
 
 void finalizeGL() {
-    glDeleteTextures(1, &markerTexture);
+    textureCache.reset();
+    readback.reset();
+    detector.reset();
+    pendingFrames.clear();
+    renderedMarkers.clear();
 }
 
 
@@ -84,19 +128,66 @@ void display() {
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     glLoadIdentity();
 
-    render(marker, markerTexture);
-    
-    auto sceneImg = getRenderedView(camera.imageWidth, camera.imageHeight);
-    auto result = recognizeMarkers(camera, sceneImg);
+    render(marker, textureCache->get(marker, TEXTURE_SIZE));
 
-    if (!result.empty()) {
-        compareMarkers(marker, result[0].marker, result[0].score);
+    // frames are mapped only once newer ones are queued, so their transfers are done
+    // by then; idleHandler() picks up the results
+    if (readback->full()) {
+        submitReadback();
     }
 
+    readback->queue();
+    renderedMarkers.push_back(marker);
+    lastQueued = std::chrono::steady_clock::now();
+
 	glutSwapBuffers();
 }
 
 
+void submitReadback() {
+    cv::Mat sceneImg;
+
+    if (readback->read(sceneImg)) {
+        auto frameId = detector->submit(sceneImg, true);
+        pendingFrames.emplace_back(frameId, renderedMarkers.front());
+    }
+
+    renderedMarkers.pop_front();
+}
+
+
+void idleHandler() {
+    // frames are only rendered on input, the last ones wait until nothing follows them
+    if (!readback->empty() && std::chrono::steady_clock::now() - lastQueued >= READBACK_IDLE_TIMEOUT) {
+        submitReadback();
+    }
+
+    if (!detector->poll(result)) {
+        std::this_thread::sleep_for(IDLE_SLEEP);
+        return;
+    }
+
+    // frames before this one were dropped
+    while (!pendingFrames.empty() && pendingFrames.front().first < result.frameId) {
+        pendingFrames.pop_front();
+    }
+
+    assert(!pendingFrames.empty() && pendingFrames.front().first == result.frameId);
+    Marker original = pendingFrames.front().second;
+    pendingFrames.pop_front();
+
+    if (!result.markers.empty()) {
+        compareMarkers(original, result.markers[0].marker, result.markers[0].score);
+    }
+
+    recognitionStats.add(result.stats);
+
+    if (recognitionStats.totalFrames() % STATS_DUMP_INTERVAL == 0) {
+        recognitionStats.print(std::cout);
+    }
+}
+
+
 void compareMarkers(const Marker& marker, const Marker& recognized, double score) {
     auto coutFlags = std::cout.flags();
     std::cout << std::setprecision(2) << std::fixed;
@@ -226,6 +317,11 @@ void normalKeysHandler(unsigned char key, int, int) {
             marker.t = origin.t;
             break;
 
+        // recognition statistics
+        case 'p':
+            recognitionStats.print(std::cout);
+            return;
+
         default:
             return;
 	}
@@ -233,3 +329,85 @@ void normalKeysHandler(unsigned char key, int, int) {
 	glutPostRedisplay();
 }
 
+
+void runLoadTest(const Camera& camera, int numMarkers, int numFrames) {
+    assert(numMarkers > 0 && numFrames > 0);
+
+    // the context needs a window, nothing is drawn into it
+    glutInitDisplayMode(GLUT_RGB | GLUT_DEPTH);
+    glutCreateWindow("MarkerPos load test");
+    glutHideWindow();
+
+    DetectorParams params;
+    params.gridSizes = { LOAD_TEST_NUM_SQUARES };
+
+    SceneRenderer renderer{ camera, SCENE_TEXTURE_SIZE, std::max(numMarkers, SCENE_ATLAS_CELLS) };
+    ViewReadback readback{ camera.imageWidth, camera.imageHeight };
+    MarkerDetector detector{ camera, params };
+    RollingStats stats{ std::size_t(numFrames) };
+
+    // a grid of the image's aspect ratio, at the distance where it fills the view
+    double aspect = double(camera.imageWidth) / camera.imageHeight;
+    int cols = int(std::ceil(std::sqrt(numMarkers * aspect)));
+    int rows = (numMarkers + cols - 1) / cols;
+    double spacing = Marker::MARKER_SIZE * LOAD_TEST_SPACING;
+    double distance = std::max(cols * spacing * camera.focalX / camera.imageWidth,
+                               rows * spacing * camera.focalY / camera.imageHeight);
+
+    std::mt19937 random;
+    std::uniform_real_distribution<double> tilt{ -LOAD_TEST_MAX_ANGLE, LOAD_TEST_MAX_ANGLE };
+    std::uniform_real_distribution<double> spin{ -180.0, 180.0 };
+    std::vector<Marker> markers;
+
+    for (int i = 0; i < numMarkers; i++) {
+        Translation t{ ((i % cols) - (cols - 1) / 2.0) * spacing, ((rows - 1) / 2.0 - (i / cols)) * spacing, -distance };
+        Rotation r{ tilt(random), tilt(random), spin(random) };
+
+        markers.emplace_back(std::uint32_t(i), t, r, LOAD_TEST_NUM_SQUARES);
+    }
+
+    std::size_t found = 0;
+
+    auto detectReadback = [&] {
+        cv::Mat view;
+
+        if (!readback.read(view))
+            return;
+
+        ImageBuffer buffer;
+        buffer.data = view.data;
+        buffer.width = view.cols;
+        buffer.height = view.rows;
+        buffer.stride = view.step;
+        buffer.format = PIXEL_RGB;
+        buffer.bottomUp = true;
+
+        RecognitionStats frameStats;
+        found += detector.detect(buffer, &frameStats).size();
+        stats.add(frameStats);
+    };
+
+    for (int frame = 0; frame < numFrames; frame++) {
+        for (auto& marker : markers) {
+            marker.r.oz = clampAngle(marker.r.oz + 1.0);
+        }
+
+        renderer.render(markers);
+
+        if (readback.full()) {
+            detectReadback();
+        }
+
+        readback.queue();
+    }
+
+    while (!readback.empty()) {
+        detectReadback();
+    }
+
+    renderer.unbind();
+
+    std::cout << "\nLoad test: " << numMarkers << " markers, " << numFrames << " frames, "
+        << double(found) / numFrames << " markers found per frame\n";
+    stats.print(std::cout);
+}
@@ -9,3 +9,7 @@ void initializeGL(const Camera& camera, const Marker& marker);
 
 // Cleanup
 void finalizeGL();
+
+// Detector load test without a visible window: numMarkers markers with distinct IDs rendered
+// offscreen by SceneRenderer for numFrames frames, statistics are printed at the end
+void runLoadTest(const Camera& camera, int numMarkers, int numFrames);
@@ -1,322 +1,285 @@
 
 #include "Recognition.h"
+#include "RecognitionStages.h"
+#include "MarkerDetector.h"
 #include "Marker.h"
 #include "Camera.h"
+#include "PlanarPose.h"
 #include "Util.h"
 
 #include <opencv2/opencv.hpp>
 #include <algorithm>
+#include <functional>
 #include <numeric>
 #include <cassert>
 #include <iomanip>
+#include <limits>
 
 
-const int       NORMALIZED_MARKER_SIZE  = 256;      // pixels (square side size)
-const int       MIN_CONTOUR_LEN         = 64;       // pixels (circumference)
-const double    MIN_QUAD_AREA           = 64.0;     // pixels^2
-const double    VALID_MARKER_TOLERANCE  = 0.2;      // percentage (0.0 - 1.0)
-const double    BINARIZATION_THRESHOLD  = 127.0;    // grey value 0.0 - 255.0
-
-
-typedef std::vector<cv::Point> Contour;
-typedef std::vector<cv::Point2f> ContourFloat;
-
-
-// Rotate image by n*90 degrees;
-void rotate90(cv::Mat& img, int angle) {
+// Rotate image by n*90 degrees, buffer holds the transposed image
+void rotate90(cv::Mat& img, int angle, cv::Mat& buffer) {
     assert(angle % 90 == 0);
     angle = ((angle % 360) + 360) % 360;
 
     if (angle == 90) {
-        cv::flip(img.t(), img, 1);
+        cv::transpose(img, buffer);
+        cv::flip(buffer, img, 1);
     }
     else if (angle == 180) {
         cv::flip(img, img, -1);
     }
     else if (angle == 270) {
-        cv::flip(img.t(), img, 0);
+        cv::transpose(img, buffer);
+        cv::flip(buffer, img, 0);
     }
 }
 
 
-// Rotate given transformation by 180 degrees around OX
-cv::Mat rotateOx180(const cv::Mat& transformationMatrix) {
-    assert(transformationMatrix.cols == 4 && transformationMatrix.rows == 4);
+// Extract contours after grey image binarization
+void findContours(const cv::Mat& sceneGrey, cv::Mat& sceneBinary, std::vector<Contour>& contours) {
+    cv::threshold(sceneGrey, sceneBinary, BINARIZATION_THRESHOLD, 0.0, CV_THRESH_TOZERO);
+    findBinaryContours(sceneBinary, contours);
+}
 
-    cv::Mat rot180 = (cv::Mat_<double>(4, 4) <<
-        1.0,  0.0,  0.0, 0.0,
-        0.0, -1.0,  0.0, 0.0,
-        0.0,  0.0, -1.0, 0.0,
-        0.0,  0.0,  0.0, 1.0);
 
-    return rot180 * transformationMatrix;
+// Extract contours of an already binarized image, the image gets modified
+void findBinaryContours(cv::Mat& sceneBinary, std::vector<Contour>& contours) {
+    cv::findContours(sceneBinary, contours, CV_RETR_LIST, CV_CHAIN_APPROX_NONE);
 }
 
 
-// Extract contours after grey image binarization
-std::vector<Contour> findContours(const cv::Mat& sceneGrey, int minContourLen = 0) {
-    std::vector<Contour> contours;
-    cv::Mat sceneBinary;
-
-    cv::threshold(sceneGrey, sceneBinary, BINARIZATION_THRESHOLD, 0.0, CV_THRESH_TOZERO);
-    cv::findContours(sceneBinary, contours, CV_RETR_LIST, CV_CHAIN_APPROX_NONE);
-    
-    contours.erase(
-        std::remove_if(std::begin(contours), std::end(contours),
-            [&minContourLen](const std::vector<cv::Point>& e) {
-                return int(e.size()) < minContourLen;
-            }),
-        std::end(contours));
-
-    return contours;
+int getNumContourBands(int sceneRows, int overlap, int numThreads) {
+    assert(overlap > 0 && numThreads > 0);
+    return std::max(1, std::min(numThreads, sceneRows / (2 * overlap)));
 }
 
 
-ContourFloat convertToFloat(const Contour& contour) {
-    ContourFloat result(contour.size());
+// Contours of rows [top, bottom) of the scene owned by a band, translated into scene coordinates.
+// Starts 2 rows above ownTop as cv::findContours() ignores the outermost pixels. Returns false
+// if an owned contour reaches a bottom edge inside the scene, i.e. it may be cut through.
+bool traceBand(const cv::Mat& scene, bool binarized, int ownTop, int ownBottom, int bottom, ContourBand& band) {
+    int top = std::max(ownTop - 2, 0);
 
-    for (std::size_t i = 0; i < result.size(); i++) {
-        result[i] = { float(contour[i].x), float(contour[i].y) };
+    // every band needs its own copy, cv::findContours() writes into it
+    if (binarized) {
+        scene.rowRange(top, bottom).copyTo(band.binary);
+    }
+    else {
+        cv::threshold(scene.rowRange(top, bottom), band.binary, BINARIZATION_THRESHOLD, 0.0, CV_THRESH_TOZERO);
     }
 
-    return result;
-}
+    cv::findContours(band.binary, band.contours, CV_RETR_LIST, CV_CHAIN_APPROX_NONE, cv::Point{ 0, top });
 
+    // contours starting above the band belong to the previous one
+    band.contours.erase(std::remove_if(std::begin(band.contours), std::end(band.contours), [&](const Contour& contour) {
+        int y = cv::boundingRect(contour).y;
+        return y < ownTop || y >= ownBottom;
+    }), std::end(band.contours));
 
-// Make sure the 4 vertices are ordered properly
-void setClockwiseOrder(Contour& quad) {
-    assert(quad.size() == 4);
+    if (bottom == scene.rows)
+        return true;
 
-    cv::Point vAB = quad[1] - quad[0];
-    cv::Point vAC = quad[2] - quad[0];
+    return std::none_of(std::begin(band.contours), std::end(band.contours), [&](const Contour& contour) {
+        cv::Rect box = cv::boundingRect(contour);
+        return box.y + box.height >= bottom - 1;
+    });
+}
 
-    int cross = (vAB.x * vAC.y) - (vAB.y * vAC.x);
 
-    if (cross < 0) {
-        std::swap(quad[1], quad[3]);
+// Contours of one band. The band reaches overlap rows into the next one, and is traced
+// again down to the bottom of the scene if that cuts through one of its contours.
+void findBandContours(const cv::Mat& scene, bool binarized, int ownTop, int ownBottom, int overlap, ContourBand& band) {
+    int bottom = std::min(ownBottom + overlap, scene.rows);
+
+    if (!traceBand(scene, binarized, ownTop, ownBottom, bottom, band)) {
+        traceBand(scene, binarized, ownTop, ownBottom, scene.rows, band);
     }
 }
 
 
-// Convert contours to quadrangles with precise corners
-std::vector<ContourFloat> getPreciseQuads(const cv::Mat& sceneGrey, const std::vector<Contour>& contours, double minQuadArea = 0.0) {
-    std::vector<ContourFloat> result;
-    ContourFloat preciseQuad;
-    Contour quad;
+void findContoursTiled(const cv::Mat& scene, std::vector<ContourBand>& bands, int numBands, int overlap,
+                       ThreadPool* pool, std::vector<Contour>& contours, bool binarized) {
+    assert(numBands > 0 && overlap > 0);
 
-    cv::TermCriteria termCriteria { cv::TermCriteria::MAX_ITER | cv::TermCriteria::EPS, 30, 0.01 };
+    if (int(bands.size()) < numBands) {
+        bands.resize(numBands);
+    }
 
-    for (auto& contour : contours) {
-        double eps = contour.size() * 0.05;
+    int rows = scene.rows;
 
-        cv::approxPolyDP(contour, quad, eps, true);
+    auto processBand = [&](std::size_t i) {
+        int ownTop = int(rows * i / numBands);
+        int ownBottom = int(rows * (i + 1) / numBands);
+        findBandContours(scene, binarized, ownTop, ownBottom, overlap, bands[i]);
+    };
 
-        if (quad.size() == 4 &&
-            cv::isContourConvex(quad) &&
-            cv::contourArea(quad) >= minQuadArea) {
-            
-            setClockwiseOrder(quad);
-            preciseQuad = convertToFloat(quad);
+    if (pool) {
+        pool->parallelFor(numBands, std::ref(processBand));
+    }
+    else {
+        for (int i = 0; i < numBands; i++) {
+            processBand(i);
+        }
+    }
 
-            cv::cornerSubPix(sceneGrey, preciseQuad, cv::Size{ 3, 3 }, cv::Size{ -1, -1 }, termCriteria);
+    // band order keeps the result deterministic
+    contours.clear();
 
-            result.push_back(preciseQuad);
+    for (int i = 0; i < numBands; i++) {
+        for (auto& contour : bands[i].contours) {
+            contours.push_back(std::move(contour));
         }
     }
-    
-    return result;
 }
 
 
-cv::Mat get2DPerspectiveTransform(const ContourFloat& quad, int normalizedMarkerSize) {
-    float size = float(normalizedMarkerSize - 1);
+void convertToFloat(const Contour& contour, ContourFloat& result) {
+    result.resize(contour.size());
 
-    ContourFloat normalizedQuad = {
-        { 0.0f, 0.0f },
-        { size, 0.0f },
-        { size, size },
-        { 0.0f, size } };
-
-    return cv::getPerspectiveTransform(quad, normalizedQuad);
+    for (std::size_t i = 0; i < result.size(); i++) {
+        result[i] = { float(contour[i].x), float(contour[i].y) };
+    }
 }
 
 
-// Calculate undistorted marker rotation (one of -90, 0, 90, 180)
-int getMarkerRotation(const cv::Mat& markerImg) {
-    std::vector<MarkerCorner> corners = { UPPER_LEFT, UPPER_RIGHT, LOWER_LEFT, LOWER_RIGHT };
-    std::vector<int> rotations = { 90, 0, 180, -90 };
-    double minValue = std::numeric_limits<double>::infinity();
+// Make sure the 4 vertices are ordered properly
+void setClockwiseOrder(Contour& quad) {
+    assert(quad.size() == 4);
 
-    std::size_t index = 0;
+    cv::Point vAB = quad[1] - quad[0];
+    cv::Point vAC = quad[2] - quad[0];
 
-    for (std::size_t i = 0; i < 4; i++) {
-        auto square = getSquare(markerImg.cols, corners[i]);
-        double color = cv::mean(markerImg(square))[0];
+    int cross = (vAB.x * vAC.y) - (vAB.y * vAC.x);
 
-        if (color < minValue) {
-            index = i;
-            minValue = color;
-        }
+    if (cross < 0) {
+        std::swap(quad[1], quad[3]);
     }
-
-    return rotations[index];
 }
 
 
-// Check if marker image has a proper white frame along the edges
-bool hasWhiteFrame(const cv::Mat& markerImg, double tolerance) {
-    auto frame = getFrameElements(markerImg.cols);
-    double value = 0.0;
+int getPyramidLevel(int minMarkerSizePx) {
+    int level = 0;
 
-    for (const auto& rect : frame) {
-        value += cv::mean(markerImg(rect))[0];
+    while (level < MAX_PYRAMID_LEVEL && (minMarkerSizePx >> (level + 1)) >= MIN_PYRAMID_MARKER_SIZE) {
+        level++;
     }
 
-    return (value / frame.size()) > ((1.0-tolerance) * 255.0);
+    return level;
 }
 
 
-// Check if the 4 corner squares are correct: 3 white and 1 black
-bool hasValidCorners(const cv::Mat& markerImg, double tolerance) {
-    std::vector<MarkerCorner> whiteCorners = { UPPER_LEFT, LOWER_LEFT, LOWER_RIGHT };
-    double highValue = (1.0 - tolerance) * 255.0;
-    double lowValue = tolerance * 255.0;
+// Convert contours to quadrangles with precise corners, each becomes a new candidate
+void getPreciseQuads(const cv::Mat& sceneGrey, const std::vector<Contour>& contours,
+                     int minContourLen, double minQuadArea, Contour& quad, CandidateList& candidates,
+                     int contourScale) {
 
-    // first check the black corner
-    auto square = getSquare(markerImg.cols, UPPER_RIGHT);
-    double color = cv::mean(markerImg(square))[0];
+    assert(contourScale > 0);
 
-    if (color > lowValue)
-        return false;
+    cv::TermCriteria termCriteria { cv::TermCriteria::MAX_ITER | cv::TermCriteria::EPS, 30, 0.01 };
 
-    for (auto corner : whiteCorners) {
-        square = getSquare(markerImg.cols, corner);
-        color = cv::mean(markerImg(square))[0];
+    // a coarse corner is off by up to contourScale pixels
+    int window = 3 * contourScale;
+    float scale = float(contourScale);
+    float offset = 0.5f * (contourScale - 1);
 
-        if (color < highValue)
-            return false;
-    }
+    for (auto& contour : contours) {
+        if (int(contour.size()) < minContourLen) continue;
 
-    return true;
-}
+        double eps = contour.size() * 0.05;
 
+        cv::approxPolyDP(contour, quad, eps, true);
 
-// Check if the marker is correct - must have a white frame, 3 white and 1 black corners
-bool isMarkerValid(const cv::Mat& markerImg, double tolerance) {
-    return hasWhiteFrame(markerImg, tolerance) &&
-           hasValidCorners(markerImg, tolerance);
-}
+        if (quad.size() == 4 &&
+            cv::isContourConvex(quad) &&
+            cv::contourArea(quad) >= minQuadArea) {
+            
+            setClockwiseOrder(quad);
 
+            auto& preciseQuad = candidates.add().quad;
+            convertToFloat(quad, preciseQuad);
 
-// Warp marker images from arbitrary quads into squares
-std::vector<cv::Mat> undistortMarkerImages(const cv::Mat& sceneGrey, const std::vector<ContourFloat>& quads, int normalizedMarkerSize) {
-    cv::Size markerSize{ normalizedMarkerSize, normalizedMarkerSize };
-    std::vector<cv::Mat> result(quads.size());
-    
-    for (std::size_t i = 0; i < result.size(); i++) {
-        auto perspective = get2DPerspectiveTransform(quads[i], normalizedMarkerSize);
-        cv::warpPerspective(sceneGrey, result[i], perspective, markerSize, cv::INTER_NEAREST);
-    }
+            // coarse pixel centers to full resolution ones
+            for (auto& corner : preciseQuad) {
+                corner = corner * scale + cv::Point2f{ offset, offset };
+            }
 
-    return result;
+            cv::cornerSubPix(sceneGrey, preciseQuad, cv::Size{ window, window }, cv::Size{ -1, -1 }, termCriteria);
+        }
+    }
 }
 
 
-// Rotate markers into upright position, rotate quad verticies accordingly
-void rotateMarkers(std::vector<cv::Mat>& markerImgs, std::vector<ContourFloat>& quads) {
-    assert(markerImgs.size() == quads.size());
+// Maps (0,0), (size,0), (size,size), (0,size) onto the quad vertices,
+// closed form of cv::getPerspectiveTransform() for a square source
+cv::Matx33d get2DPerspectiveTransform(const ContourFloat& quad, int normalizedMarkerSize) {
+    assert(quad.size() == 4);
 
-    for (std::size_t i = 0; i < markerImgs.size(); i++) {
+    double x0 = quad[0].x, y0 = quad[0].y;
+    double x1 = quad[1].x, y1 = quad[1].y;
+    double x2 = quad[2].x, y2 = quad[2].y;
+    double x3 = quad[3].x, y3 = quad[3].y;
 
-        int rotation = getMarkerRotation(markerImgs[i]);
+    double sx = x0 - x1 + x2 - x3;
+    double sy = y0 - y1 + y2 - y3;
 
-        rotate90(markerImgs[i], rotation);
+    double dx1 = x1 - x2, dx2 = x3 - x2;
+    double dy1 = y1 - y2, dy2 = y3 - y2;
+    double det = dx1 * dy2 - dx2 * dy1;
 
-        int rotPointsBy = (4 - rotation / 90) % 4;
-        std::rotate(std::begin(quads[i]), std::begin(quads[i]) + rotPointsBy, std::end(quads[i]));
-    }
-}
+    double g = (sx * dy2 - dx2 * sy) / det;
+    double h = (dx1 * sy - sx * dy1) / det;
 
+    // unit square -> quad
+    cv::Matx33d unitToQuad(
+        x1 - x0 + g * x1,   x3 - x0 + h * x3,   x0,
+        y1 - y0 + g * y1,   y3 - y0 + h * y3,   y0,
+        g,                  h,                  1.0);
 
-// Remove invalid markers along with their corresponding quadrangles
-void filterInvalidMarkers(std::vector<cv::Mat>& markerImgs, std::vector<ContourFloat>& quads, double tolerance) {
-    assert(markerImgs.size() == quads.size());
+    double scale = 1.0 / (normalizedMarkerSize - 1);
 
-    for (int i = int(markerImgs.size())-1; i >= 0; i--) {
-        if (!isMarkerValid(markerImgs[i], tolerance)) {
-            markerImgs.erase(std::begin(markerImgs) + i);
-            quads.erase(std::begin(quads) + i);
-        }
-    }
+    cv::Matx33d squareToUnit(
+        scale,  0.0,    0.0,
+        0.0,    scale,  0.0,
+        0.0,    0.0,    1.0);
+
+    return unitToQuad * squareToUnit;
 }
 
 
-// Calculate marker ID
-int getId(const cv::Mat& markerImg) {
-    int bitIndex = 0;
-    int id = 0;
-    
-    for (const auto& square : getIdSquares(markerImg.cols)) {
-        int bitValue = cv::mean(markerImg(square))[0] < 127.0 ? 0 : 1;
-        id |= bitValue << bitIndex++;
-    }
+// Warp a marker image from an arbitrary quad into a square
+void undistortMarkerImage(const cv::Mat& sceneGrey, MarkerCandidate& candidate, int normalizedMarkerSize) {
+    cv::Size markerSize{ normalizedMarkerSize, normalizedMarkerSize };
 
-    return id;
+    auto perspective = get2DPerspectiveTransform(candidate.quad, normalizedMarkerSize);
+    cv::warpPerspective(sceneGrey, candidate.image, perspective, markerSize, cv::INTER_NEAREST | cv::WARP_INVERSE_MAP);
 }
 
 
-// Calculate marker recognition score given its ID
-double calculateScore(const cv::Mat& markerImg, int id) {
-    double totalSum = 0.0;
-
-    // all frame elements
-    for (const auto& rect : getFrameElements(markerImg.cols)) {
-        totalSum += cv::sum(markerImg(rect))[0];
-    }
-
-    // 3 white corners
-    for (const auto& corner : { UPPER_LEFT, LOWER_LEFT, LOWER_RIGHT }) {
-        auto square = getSquare(markerImg.cols, corner);
-        totalSum += cv::sum(markerImg(square))[0];
+// Warp marker images from arbitrary quads into squares
+void undistortMarkerImages(const cv::Mat& sceneGrey, CandidateList& candidates, int normalizedMarkerSize) {
+    for (std::size_t i = 0; i < candidates.size(); i++) {
+        undistortMarkerImage(sceneGrey, candidates[i], normalizedMarkerSize);
     }
+}
 
-    // 1 black corner
-    auto square = getSquare(markerImg.cols, UPPER_RIGHT);
-    totalSum += 255.0 * square.area() - cv::sum(markerImg(square))[0];
-
-    // marker id squares
-    auto idSqaures = getIdSquares(markerImg.cols);
-
-    for (int bitIndex = 0; bitIndex < int(idSqaures.size()); bitIndex++) {
-
-        double sum = cv::sum(markerImg(idSqaures[bitIndex]))[0];
-
-        // the square could be white
-        if (id & (1 << bitIndex)) {
-            totalSum += sum;
-        }
-
-        // or black
-        else {
-            totalSum += 255.0 * idSqaures[bitIndex].area() - sum;
-        }
-    }
 
-    return totalSum / markerImg.size().area() / 255.0;
+void rotateQuad(ContourFloat& quad, int rotation) {
+    int rotPointsBy = (4 - rotation / 90) % 4;
+    std::rotate(std::begin(quad), std::begin(quad) + rotPointsBy, std::end(quad));
 }
 
 
 // Convert rotation matrix into Euler angles
-Rotation getEulerAngles(const cv::Mat& r) {
-    double m00 = r.at<double>(0, 0);
-    double m01 = r.at<double>(0, 1);
-    double m02 = r.at<double>(0, 2);
-    double m10 = r.at<double>(1, 0);
-    double m11 = r.at<double>(1, 1);
-    double m12 = r.at<double>(1, 2);
-    double m20 = r.at<double>(2, 0);
-    double m21 = r.at<double>(2, 1);
-    double m22 = r.at<double>(2, 2);
+Rotation getEulerAngles(const cv::Matx33d& r) {
+    double m00 = r(0, 0);
+    double m01 = r(0, 1);
+    double m02 = r(0, 2);
+    double m10 = r(1, 0);
+    double m11 = r(1, 1);
+    double m12 = r(1, 2);
+    double m20 = r(2, 0);
+    double m21 = r(2, 1);
+    double m22 = r(2, 2);
 
     double ox = std::atan2(m12, m22);
     double c2 = std::sqrt(m00*m00 + m01*m01);
@@ -329,43 +292,17 @@ Rotation getEulerAngles(const cv::Mat& r) {
 }
 
 
-// Extract translation vector
-Translation getTranslation(const cv::Mat& r) {
-    double x = r.at<double>(0, 3);
-    double y = r.at<double>(1, 3);
-    double z = r.at<double>(2, 3);
-
-    return{ x, y, z };
-}
-
-
-// Calculate 3D transformation between 2D image points and their 3D counterparts
-Transformation calculateTransformation(const Camera& camera,
-    const std::vector<cv::Point2f>& points2D,
-    const std::vector<cv::Point3f>& points3D) {
-
-    assert(points2D.size() == points3D.size());
-
-    cv::Mat cameraMatrix = getCameraMatrix(camera);
-    cv::Mat distortionCoefficients = {};
-
-    cv::Mat transformationMatrix44{ 4, 4, CV_64FC1, 1.0 };
-    cv::Mat rotationMatrix33, translationVec, rotationVec;
-
-    cv::solvePnP(points3D, points2D, cameraMatrix, distortionCoefficients, rotationVec, translationVec, false);
-    cv::Rodrigues(rotationVec, rotationMatrix33);
-
-    // create a 4x4 transformation matrix
-    rotationMatrix33.copyTo(transformationMatrix44({ 0, 0, 3, 3 }));
-    translationVec.copyTo(transformationMatrix44({ 3, 0, 1, 3 }));
-
+Transformation getTransformation(const cv::Matx33d& rotation, const cv::Vec3d& translation) {
     // convert from OpenCV camera space to OpenGL camera space
     // by rotating 180 degrees around OX
-    auto openGLMatrix = rotateOx180(transformationMatrix44);
+    cv::Matx33d rotOx180{
+        1.0,  0.0,  0.0,
+        0.0, -1.0,  0.0,
+        0.0,  0.0, -1.0 };
+
+    Translation t{ translation[0], -translation[1], -translation[2] };
+    Rotation r = getEulerAngles(rotOx180 * rotation);
 
-    Translation t = getTranslation(openGLMatrix);
-    Rotation r = getEulerAngles(openGLMatrix);
-    
     // remove our OX rotation information
     r.ox = clampAngle(180.0 - r.ox);
     r.oy = clampAngle(r.oy);
@@ -375,28 +312,38 @@ Transformation calculateTransformation(const Camera& camera,
 }
 
 
-// Calculate quadrangle 3D transformation
+// Calculate quadrangle 3D transformation, the better of the two planar poses
 Transformation calculateTransformation(const Camera& camera, const ContourFloat& quad) {
-    auto half = float(Marker::MARKER_SIZE) / 2.0f;
+    PlanarPose cameraPose;
+    return calculateTransformation(camera, quad, nullptr, cameraPose);
+}
+
+
+Transformation calculateTransformation(const Camera& camera, const ContourFloat& quad,
+                                       const PlanarPose* previous, PlanarPose& cameraPose) {
+    bool solved;
 
-    std::vector<cv::Point3f> markerCorners3D = {
-        { -half, -half, 0.0f },
-        { +half, -half, 0.0f },
-        { +half, +half, 0.0f },
-        { -half, +half, 0.0f } };
+    if (previous) {
+        solved = solveSquarePose(camera, quad, Marker::MARKER_SIZE, *previous, cameraPose);
+    }
+    else {
+        PlanarPoseSolutions solutions;
+        solved = solveSquarePose(camera, quad, Marker::MARKER_SIZE, POSE_REFINE_ITERATIONS, solutions) > 0;
+        cameraPose = solutions.poses[0];
+    }
+
+    if (!solved) {
+        cameraPose.error = std::numeric_limits<double>::infinity();
+        return{};
+    }
 
-    return calculateTransformation(camera, quad, markerCorners3D);
+    return getTransformation(cameraPose.R, cameraPose.t);
 }
 
 
 // Show debug information
-void debugMarkers(const cv::Mat& sceneRGB,
-                  const std::vector<cv::Mat>& markerImgs,
-                  const std::vector<MarkerScore>& markers,
-                  const std::vector<ContourFloat>& quads) {
-
-    assert(markerImgs.size() == markers.size());
-    assert(markerImgs.size() == quads.size());
+void debugMarkers(const cv::Mat& sceneRGB, const CandidateList& candidates, const std::vector<MarkerScore>& markers) {
+    assert(candidates.size() == markers.size());
 
     // helper function
     auto putText = [](cv::Mat& img, const std::string& str, cv::Point pt) {
@@ -408,23 +355,25 @@ void debugMarkers(const cv::Mat& sceneRGB,
 
     cv::cvtColor(sceneRGB, dbgSceneBGR, CV_RGB2BGR);
 
-    for (std::size_t i = 0; i < quads.size(); i++) {
+    for (std::size_t i = 0; i < candidates.size(); i++) {
+        const auto& quad = candidates[i].quad;
+
         // first draw all the lines, then captions
         for (int j = 0; j < 4; j++) {
-            cv::line(dbgSceneBGR, quads[i][j], quads[i][(j + 1) % 4], CV_RGB(0, 255, 0), 2);
+            cv::line(dbgSceneBGR, quad[j], quad[(j + 1) % 4], CV_RGB(0, 255, 0), 2);
         }
         for (int j = 0; j < 4; j++) {
-            putText(dbgSceneBGR, std::to_string(j), quads[i][j]);
+            putText(dbgSceneBGR, std::to_string(j), quad[j]);
         }
     }
 
     cv::imshow("Debug scene", dbgSceneBGR);
 
     // show each marker after warping
-    if (markerImgs.size() == 0) return;
+    if (candidates.empty() || candidates[0].image.empty()) return;
 
-    int numImages = markerImgs.size();
-    int imageSize = markerImgs[0].rows;
+    int numImages = int(candidates.size());
+    int imageSize = candidates[0].image.rows;
 
     cv::Mat dbgMarkers{ imageSize * numImages, imageSize, CV_8UC3 };
 
@@ -433,7 +382,10 @@ void debugMarkers(const cv::Mat& sceneRGB,
         cv::Mat markerImgBGR;
         auto img = dbgMarkers(roi);
 
-        cv::cvtColor(markerImgs[i], markerImgBGR, CV_GRAY2BGR);
+        cv::Mat markerImg = candidates[i].image.clone(), buffer;
+        rotate90(markerImg, candidates[i].decoding.rotation, buffer);
+
+        cv::cvtColor(markerImg, markerImgBGR, CV_GRAY2BGR);
 
         markerImgBGR.copyTo(img);
 
@@ -441,7 +393,8 @@ void debugMarkers(const cv::Mat& sceneRGB,
         putText(img, "id", { 10, 20 });
         putText(img, id, { 70, 20 });
 
-        auto center = 0.25 * std::accumulate(std::begin(quads[i]), std::end(quads[i]), cv::Point2f{ 0.0f, 0.0f });
+        const auto& quad = candidates[i].quad;
+        auto center = 0.25 * std::accumulate(std::begin(quad), std::end(quad), cv::Point2f{ 0.0f, 0.0f });
         auto pos = std::to_string(int(center.x)) + ", " + std::to_string(int(center.y));
         putText(img, "pos", { 10, 40 });
         putText(img, pos, { 70, 40 });
@@ -455,32 +408,13 @@ void debugMarkers(const cv::Mat& sceneRGB,
 }
 
 
-std::vector<MarkerScore> recognizeMarkers(const Camera& camera, const cv::Mat& sceneRGB) {
-    std::vector<MarkerScore> markers;
-    cv::Mat sceneGrey;
-
-    cv::cvtColor(sceneRGB, sceneGrey, CV_RGB2GRAY);
-
-    auto contours = findContours(sceneGrey, MIN_CONTOUR_LEN);
-    auto quads = getPreciseQuads(sceneGrey, contours, MIN_QUAD_AREA);
-    auto markerImages = undistortMarkerImages(sceneGrey, quads, NORMALIZED_MARKER_SIZE);
-
-    rotateMarkers(markerImages, quads);
-    filterInvalidMarkers(markerImages, quads, VALID_MARKER_TOLERANCE);
-
-    for (std::size_t i = 0; i < markerImages.size(); i++) {
-
-        int     id = getId(markerImages[i]);
-        double  score = calculateScore(markerImages[i], id);
-        auto    trans = calculateTransformation(camera, quads[i]);
-
-        markers.push_back({ Marker(id, trans.t, trans.r), score });
-    }
+std::vector<MarkerScore> recognizeMarkers(const Camera& camera, const cv::Mat& sceneRGB, RecognitionStats* stats) {
+    MarkerDetector detector{ camera };
+    return detector.detect(sceneRGB, stats);
+}
 
-#ifdef DEBUG_MARKERS
-    debugMarkers(sceneRGB, markerImages, markers, quads);
-#endif
 
-    return markers;
+std::vector<MarkerScore> recognizeMarkers(const Camera& camera, const ImageBuffer& scene, RecognitionStats* stats) {
+    MarkerDetector detector{ camera };
+    return detector.detect(scene, stats);
 }
-
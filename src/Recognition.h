@@ -2,6 +2,8 @@
 
 #include "Marker.h"
 #include "Camera.h"
+#include "ImageBuffer.h"
+#include "Statistics.h"
 
 #include <opencv2/opencv.hpp>
 #include <vector>
@@ -13,6 +15,40 @@ struct MarkerScore {
 };
 
 
-// Recognizes markers given their 2D image and camera parameters
-std::vector<MarkerScore> recognizeMarkers(const Camera& camera, const cv::Mat& sceneRGB);
+enum DecodeMode {
+    DECODE_WARP,        // warp every candidate into a normalized marker image
+    DECODE_SAMPLE       // sample the fields straight from the scene through the homography
+};
+
+
+enum BinarizationMode {
+    BINARIZE_GLOBAL,    // fixed BINARIZATION_THRESHOLD
+    BINARIZE_ADAPTIVE   // brighter than the local mean, see adaptiveThreshold()
+};
+
+
+struct DetectorParams {
+    DecodeMode          decodeMode      = DECODE_WARP;
+    int                 samplesPerSide  = 4;                        // DECODE_SAMPLE: samplesPerSide^2 points per field
+    std::vector<int>    gridSizes       = { Marker::NUM_SQUARES };  // accepted Marker::numSquares values
+    bool                parallel        = true;                     // per-candidate work on ThreadPool::shared()
+    int                 contourBands    = 0;                        // parallel findContours() bands, 0 picks by frame size
+    int                 bandOverlap     = 256;                      // pixels each band reaches into the next one
+    int                 minMarkerSizePx = 0;                        // smallest marker side to find, picks a coarser
+                                                                    // contour pyramid level; 0 keeps full resolution
+    BinarizationMode    binarization    = BINARIZE_GLOBAL;
+    int                 adaptiveWindow  = 31;                       // BINARIZE_ADAPTIVE: odd window side in pixels
+    int                 adaptiveOffset  = 10;                       // BINARIZE_ADAPTIVE: grey levels above the mean
+    bool                warmStartPose   = false;                    // start from the pose a marker had in the previous
+                                                                    // frame, for video; see PoseCache
+};
+
+
+// Recognizes markers given their 2D image and camera parameters,
+// stage durations and candidate counts are written to stats if given.
+// Builds a MarkerDetector per call; only the undistortion grids of the last few cameras
+// are shared between calls (see UndistortionMap), so video should use a long-lived one.
+std::vector<MarkerScore> recognizeMarkers(const Camera& camera, const cv::Mat& sceneRGB, RecognitionStats* stats = nullptr);
 
+// Same as above for a frame in caller memory in any PixelFormat, wrapped without copying
+std::vector<MarkerScore> recognizeMarkers(const Camera& camera, const ImageBuffer& scene, RecognitionStats* stats = nullptr);
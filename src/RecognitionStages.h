@@ -0,0 +1,169 @@
+#pragma once
+
+#include "Marker.h"
+#include "MarkerLayout.h"
+#include "Camera.h"
+#include "PlanarPose.h"
+#include "Recognition.h"
+#include "ThreadPool.h"
+#include "Transformation.h"
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <vector>
+
+
+// Individual steps of recognizeMarkers(), exposed for benchmarking
+
+
+const int       NORMALIZED_MARKER_SIZE  = 256;      // pixels (square side size)
+const int       MIN_CONTOUR_LEN         = 64;       // pixels (circumference)
+const double    MIN_QUAD_AREA           = 64.0;     // pixels^2
+const double    VALID_MARKER_TOLERANCE  = 0.2;      // percentage (0.0 - 1.0)
+const double    BINARIZATION_THRESHOLD  = 127.0;    // grey value 0.0 - 255.0
+const int       MIN_PYRAMID_MARKER_SIZE = 32;       // pixels (square side size) on the contour pyramid level
+const int       MAX_PYRAMID_LEVEL       = 3;
+
+
+typedef std::vector<cv::Point> Contour;
+typedef std::vector<cv::Point2f> ContourFloat;
+
+
+// Geometry of the normalized marker images with an N*N grid
+template <int N>
+using NormalizedLayout = MarkerLayout<N, NORMALIZED_MARKER_SIZE>;
+
+
+// Mean grey values of the frame strips and of every square
+struct MarkerCells {
+    double frame[4];                                                    // up, down, left, right
+    double squares[Marker::MAX_NUM_SQUARES * Marker::MAX_NUM_SQUARES];  // row-major
+};
+
+
+// Best decoding of a candidate among the detector grid sizes
+struct MarkerDecoding {
+    MarkerCells     cells;              // as read, not rotated
+    std::uint64_t   bits        = 0;    // one per square of cells, set if white (row-major, LSB first)
+    int             rotation    = 0;    // of the cells, the quad is already upright
+    int             numSquares  = 0;    // 0 if no grid size matched
+    std::uint32_t   id          = 0;
+    double          score       = 0.0;
+};
+
+
+// A quad that might be a marker along with its undistorted image, decoding and pose
+struct MarkerCandidate {
+    ContourFloat    quad;                   // undistorted after decoding starts if the camera has lens distortion
+    cv::Mat         image;                  // DECODE_WARP only
+    cv::Mat         integral;               // integral image of the above
+    MarkerDecoding  decoding;
+    Transformation  pose;
+    PlanarPose      cameraPose;             // OpenCV camera space pose the above comes from
+    double          stageNs[NUM_STAGES];    // time spent on this candidate
+};
+
+
+// Candidates of the current frame. Elements past size() are kept alive
+// so that their buffers can be reused by the next frame.
+class CandidateList {
+public:
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    MarkerCandidate& operator[](std::size_t i) { return pool[i]; }
+    const MarkerCandidate& operator[](std::size_t i) const { return pool[i]; }
+
+    void clear() { count = 0; }
+
+    // Returns the next unused candidate
+    MarkerCandidate& add() {
+        if (count == pool.size()) {
+            pool.emplace_back();
+        }
+        return pool[count++];
+    }
+
+    // Keep candidates for which pred() is true, preserving their order
+    template <typename Pred>
+    void filter(Pred pred) {
+        std::size_t kept = 0;
+
+        for (std::size_t i = 0; i < count; i++) {
+            if (pred(pool[i])) {
+                if (i != kept) {
+                    std::swap(pool[i], pool[kept]);
+                }
+                kept++;
+            }
+        }
+
+        count = kept;
+    }
+
+private:
+    std::vector<MarkerCandidate> pool;
+    std::size_t count = 0;
+};
+
+
+// Buffers of one horizontal band of findContoursTiled()
+struct ContourBand {
+    cv::Mat                 binary;
+    std::vector<Contour>    contours;
+};
+
+
+// Extract contours after grey image binarization
+void findContours(const cv::Mat& sceneGrey, cv::Mat& sceneBinary, std::vector<Contour>& contours);
+
+// Extract contours of an already binarized image, the image gets modified
+void findBinaryContours(cv::Mat& sceneBinary, std::vector<Contour>& contours);
+
+// Number of bands for findContoursTiled(), every band is at least 2*overlap rows high
+int getNumContourBands(int sceneRows, int overlap, int numThreads);
+
+// findContours() over horizontal bands in parallel (serially without a pool).
+// Contours are kept by the band holding their top row, so each is found exactly once.
+// Each band reaches overlap rows into the next one. A band whose contour is taller and
+// crosses the seam is traced again down to the bottom of the scene, which costs time but
+// finds the same contours as a single pass. The scene is either grey or already binarized.
+void findContoursTiled(const cv::Mat& scene, std::vector<ContourBand>& bands, int numBands, int overlap,
+                       ThreadPool* pool, std::vector<Contour>& contours, bool binarized = false);
+
+// Pyramid level for contour extraction that still keeps markers of the given size
+// at least MIN_PYRAMID_MARKER_SIZE pixels wide, 0 for the full resolution
+int getPyramidLevel(int minMarkerSizePx);
+
+// Convert contours to quadrangles with precise corners, each becomes a new candidate.
+// Contours may come from an image contourScale times smaller than sceneGrey, the limits
+// apply to the contours as given and the corners are refined at full resolution.
+void getPreciseQuads(const cv::Mat& sceneGrey, const std::vector<Contour>& contours,
+                     int minContourLen, double minQuadArea, Contour& quadBuffer, CandidateList& candidates,
+                     int contourScale = 1);
+
+// Homography mapping normalized marker image pixels onto the quad
+cv::Matx33d get2DPerspectiveTransform(const ContourFloat& quad, int normalizedMarkerSize);
+
+// Warp a marker image from an arbitrary quad into a square
+void undistortMarkerImage(const cv::Mat& sceneGrey, MarkerCandidate& candidate, int normalizedMarkerSize);
+
+// Warp marker images from arbitrary quads into squares
+void undistortMarkerImages(const cv::Mat& sceneGrey, CandidateList& candidates, int normalizedMarkerSize);
+
+// Rotate quad vertices to follow a marker rotation (one of -90, 0, 90, 180)
+void rotateQuad(ContourFloat& quad, int rotation);
+
+// Convert a pose in OpenCV camera space into OpenGL camera space and Euler angles
+Transformation getTransformation(const cv::Matx33d& rotation, const cv::Vec3d& translation);
+
+// Calculate quadrangle 3D transformation
+Transformation calculateTransformation(const Camera& camera, const ContourFloat& quad);
+
+// Same as above, warm started from the marker pose of the previous frame unless previous is nullptr.
+// cameraPose gets the solved pose, its error is infinite if there is none.
+Transformation calculateTransformation(const Camera& camera, const ContourFloat& quad,
+                                       const PlanarPose* previous, PlanarPose& cameraPose);
+
+// Show debug information
+void debugMarkers(const cv::Mat& sceneRGB, const CandidateList& candidates, const std::vector<MarkerScore>& markers);
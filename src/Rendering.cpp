@@ -2,9 +2,14 @@
 #include "Rendering.h"
 #include "Marker.h"
 #include "Camera.h"
+#include "GLFunctions.h"
+#include "MarkerImageCache.h"
 
 #include <opencv2/opencv.hpp>
 #include <GL/freeglut.h>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
 
 
 void render(const Marker& marker, GLuint textureId) {
@@ -53,21 +58,10 @@ GLuint createTexture(int width, int height, const void* pixels) {
 
 
 GLuint createMarkerTexture(const Marker& marker, int textureSize) {
-    cv::Mat texture{ textureSize, textureSize, CV_8UC3, CV_RGB(255, 255, 255) };
-
-    auto squares = getIdSquares(textureSize);
-    auto blackCorner = getSquare(textureSize, UPPER_RIGHT);
-
-    texture(blackCorner) = CV_RGB(0, 0, 0);
-
-    for (int bitIndex = 0; bitIndex < int(squares.size()); bitIndex++) {
-        if (~marker.id & (1 << bitIndex)) {
-            texture(squares[bitIndex]) = CV_RGB(0, 0, 0);
-        }
-    }
+    cv::Mat texture;
 
     // OpenGL likes its textures upside down
-    cv::flip(texture, texture, 0);
+    cv::flip(MarkerImageCache::shared().get(marker, textureSize), texture, 0);
 
     return createTexture(texture.cols, texture.rows, texture.data);
 }
@@ -83,6 +77,101 @@ cv::Mat getRenderedView(int width, int height) {
 }
 
 
+ViewReadback::ViewReadback(int width, int height, int ringSize)
+    : width(width), height(height), ringSize(ringSize), first(0), count(0) {
+    assert(width > 0 && height > 0 && ringSize > 0);
+
+    const auto& gl = getGLFunctions();
+
+    if (!gl.hasBuffers()) {
+        frames.resize(ringSize);
+        return;
+    }
+
+    buffers.resize(ringSize);
+    gl.genBuffers(ringSize, buffers.data());
+
+    for (GLuint buffer : buffers) {
+        gl.bindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+        gl.bufferData(GL_PIXEL_PACK_BUFFER, std::ptrdiff_t(width) * height * 3, nullptr, GL_STREAM_READ);
+    }
+
+    gl.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+
+ViewReadback::~ViewReadback() {
+    if (!buffers.empty()) {
+        getGLFunctions().deleteBuffers(ringSize, buffers.data());
+    }
+}
+
+
+bool ViewReadback::empty() const {
+    return count == 0;
+}
+
+
+bool ViewReadback::full() const {
+    return count == ringSize;
+}
+
+
+void ViewReadback::queue() {
+    assert(!full());
+
+    int slot = (first + count) % ringSize;
+    count++;
+
+    // rows of width * 3 bytes, as in a cv::Mat
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+    if (buffers.empty()) {
+        frames[slot].create(height, width, CV_8UC3);
+        glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, frames[slot].data);
+        return;
+    }
+
+    // with a pack buffer bound glReadPixels() only queues the transfer
+    const auto& gl = getGLFunctions();
+    gl.bindBuffer(GL_PIXEL_PACK_BUFFER, buffers[slot]);
+    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+    gl.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+
+bool ViewReadback::read(cv::Mat& view) {
+    if (empty())
+        return false;
+
+    int slot = first;
+    first = (first + 1) % ringSize;
+    count--;
+
+    if (buffers.empty()) {
+        // handed over, queue() allocates the next one
+        view = frames[slot];
+        frames[slot].release();
+        return true;
+    }
+
+    const auto& gl = getGLFunctions();
+    gl.bindBuffer(GL_PIXEL_PACK_BUFFER, buffers[slot]);
+
+    const void* pixels = gl.mapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+
+    // a new image every time, the previous one may still be in the detector
+    if (pixels) {
+        view = cv::Mat{ height, width, CV_8UC3 };
+        std::memcpy(view.data, pixels, std::size_t(width) * height * 3);
+        gl.unmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+
+    gl.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return pixels != nullptr;
+}
+
+
 void loadPerspectiveMatrix(const Camera& camera, GLdouble nearPlane, GLdouble farPlane) {
 
     // we need to invert principal point's Y
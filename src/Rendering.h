@@ -4,6 +4,7 @@
 #include "Camera.h"
 
 #include <opencv2/opencv.hpp>
+#include <vector>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -12,12 +13,51 @@
 #include <GL/GL.h>
 
 
+const int READBACK_RING_SIZE = 3;   // frames in flight between ViewReadback::queue() and read()
+
+
 // Renders the marker given its previously created texture
 void    render(const Marker& marker, GLuint textureId);
 
 // Reads OpenGL view and returns it as a cv::Mat
 cv::Mat getRenderedView(int width, int height);
 
+// Asynchronous readback of the rendered view through a ring of pixel buffer objects.
+// queue() starts a glReadPixels() into the next buffer and returns at once, read() maps
+// the oldest buffer later, once the transfer had time to finish behind the rendering.
+// Frames stay bottom-up as OpenGL stores them, the detector reverses the rows within
+// its grey conversion. Without pixel buffer objects (OpenGL < 2.1) reads are synchronous.
+class ViewReadback {
+public:
+    ViewReadback(int width, int height, int ringSize = READBACK_RING_SIZE);
+    ~ViewReadback();
+
+    ViewReadback(const ViewReadback&) = delete;
+    ViewReadback& operator=(const ViewReadback&) = delete;
+
+    bool empty() const;
+    bool full() const;
+
+    // Start reading the current frame, the ring must not be full
+    void queue();
+
+    // Oldest queued frame as a new bottom-up RGB image, false if none is queued
+    bool read(cv::Mat& view);
+
+private:
+    int                     width;
+    int                     height;
+    int                     ringSize;
+    std::vector<GLuint>     buffers;        // empty without pixel buffer objects
+    std::vector<cv::Mat>    frames;         // synchronous reads without them
+    int                     first;          // slot of the oldest queued frame
+    int                     count;
+};
+
+// RGB texture with linear filtering, pixels are bottom-up
+GLuint  createTexture(int width, int height, const void* pixels);
+
+// New texture of the marker image, see MarkerTextureCache for reusing them
 GLuint  createMarkerTexture(const Marker& marker, int textureSize);
 
 // Creates and loads a perspective matrix
@@ -0,0 +1,213 @@
+#include "SceneRenderer.h"
+#include "MarkerImageCache.h"
+#include "Rendering.h"
+#include "SoftwareRendering.h"
+
+#include <cassert>
+#include <cmath>
+
+
+const double SCENE_NEAR_PLANE   = 0.1;
+const double SCENE_FAR_PLANE    = 100.0;
+const int    VERTEX_FLOATS      = 5;        // x, y, z, u, v
+
+
+SceneRenderer::SceneRenderer(const Camera& camera, int textureSize, int atlasCells)
+    : camera(camera), textureSize(textureSize), framebuffer(0), colorBuffer(0), depthBuffer(0), vertexBuffer(0),
+      atlas(0), atlasCols(0), atlasRows(0), cells(atlasCells, AtlasCell{ 0, -1 }), frame(0) {
+    assert(textureSize > 0 && atlasCells > 0);
+
+    const auto& gl = getGLFunctions();
+    assert(gl.hasBuffers() && gl.hasFramebuffers() && "SceneRenderer needs OpenGL 3.0");
+
+    gl.genRenderbuffers(1, &colorBuffer);
+    gl.bindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    gl.renderbufferStorage(GL_RENDERBUFFER, GL_RGB8, camera.imageWidth, camera.imageHeight);
+
+    gl.genRenderbuffers(1, &depthBuffer);
+    gl.bindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    gl.renderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, camera.imageWidth, camera.imageHeight);
+    gl.bindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    gl.genFramebuffers(1, &framebuffer);
+    gl.bindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    gl.framebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+    gl.framebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+
+    bool complete = gl.checkFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    assert(complete && "Incomplete scene framebuffer");
+    (void)complete;
+
+    gl.bindFramebuffer(GL_FRAMEBUFFER, 0);
+    gl.genBuffers(1, &vertexBuffer);
+
+    // nearly square, allocated once and filled cell by cell
+    atlasCols = int(std::ceil(std::sqrt(double(atlasCells))));
+    atlasRows = (atlasCells + atlasCols - 1) / atlasCols;
+
+    GLint maxSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+    assert(atlasCols * textureSize <= maxSize && "Atlas too large, lower the texture size or cell count");
+
+    atlas = createTexture(atlasCols * textureSize, atlasRows * textureSize, nullptr);
+}
+
+
+SceneRenderer::~SceneRenderer() {
+    const auto& gl = getGLFunctions();
+
+    glDeleteTextures(1, &atlas);
+    gl.deleteBuffers(1, &vertexBuffer);
+    gl.deleteFramebuffers(1, &framebuffer);
+    gl.deleteRenderbuffers(1, &depthBuffer);
+    gl.deleteRenderbuffers(1, &colorBuffer);
+}
+
+
+int SceneRenderer::getAtlasCell(const Marker& marker) {
+    auto key = MarkerImageCache::getKey(marker, textureSize);
+    auto it = cellIndex.find(key);
+
+    if (it != cellIndex.end()) {
+        cells[it->second].lastFrame = frame;
+        return it->second;
+    }
+
+    // an unused cell or else the least recently drawn one, never one of this frame
+    int cell = 0;
+
+    for (int i = 1; i < int(cells.size()); i++) {
+        if (cells[i].lastFrame < cells[cell].lastFrame) {
+            cell = i;
+        }
+    }
+
+    // every cell holds a marker of this frame already
+    if (cells[cell].lastFrame == frame)
+        return -1;
+
+    if (cells[cell].lastFrame >= 0) {
+        cellIndex.erase(cells[cell].key);
+    }
+
+    cells[cell] = { key, frame };
+    cellIndex[key] = cell;
+
+    // OpenGL likes its textures upside down
+    cv::Mat image;
+    cv::flip(MarkerImageCache::shared().get(marker, textureSize), image, 0);
+
+    glBindTexture(GL_TEXTURE_2D, atlas);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, (cell % atlasCols) * textureSize, (cell / atlasCols) * textureSize,
+                    textureSize, textureSize, GL_RGB, GL_UNSIGNED_BYTE, image.data);
+
+    return cell;
+}
+
+
+void SceneRenderer::fillVertices(const std::vector<Marker>& markers) {
+    double half = Marker::MARKER_SIZE / 2.0;
+
+    // half a texel inwards, so linear filtering doesn't reach into the neighbouring cells
+    double insetU = 0.5 / (atlasCols * textureSize);
+    double insetV = 0.5 / (atlasRows * textureSize);
+
+    // marker corners as in render(), counter-clockwise from the lower left
+    static const double CORNER_X[4] = { -1.0, 1.0, 1.0, -1.0 };
+    static const double CORNER_Y[4] = { -1.0, -1.0, 1.0, 1.0 };
+    static const int TRIANGLES[6] = { 0, 1, 2, 2, 3, 0 };
+
+    vertices.resize(markers.size() * 6 * VERTEX_FLOATS);
+    GLfloat* vertex = vertices.data();
+
+    for (const auto& marker : markers) {
+        int cell = getAtlasCell(marker);
+
+        if (cell < 0)
+            continue;
+
+        int col = cell % atlasCols, row = cell / atlasCols;
+
+        double u0 = double(col) / atlasCols + insetU;
+        double u1 = double(col + 1) / atlasCols - insetU;
+        double v0 = double(row) / atlasRows + insetV;
+        double v1 = double(row + 1) / atlasRows - insetV;
+
+        cv::Mat rotation = getRotationMatrix(marker.r);
+        const double* r = rotation.ptr<double>();
+
+        for (int index : TRIANGLES) {
+            double x = CORNER_X[index] * half;
+            double y = CORNER_Y[index] * half;
+
+            *vertex++ = GLfloat(r[0] * x + r[1] * y + marker.t.x);
+            *vertex++ = GLfloat(r[3] * x + r[4] * y + marker.t.y);
+            *vertex++ = GLfloat(r[6] * x + r[7] * y + marker.t.z);
+            *vertex++ = GLfloat(CORNER_X[index] < 0.0 ? u0 : u1);
+            *vertex++ = GLfloat(CORNER_Y[index] < 0.0 ? v0 : v1);
+        }
+    }
+
+    vertices.resize(vertex - vertices.data());
+}
+
+
+int SceneRenderer::render(const std::vector<Marker>& markers) {
+    const auto& gl = getGLFunctions();
+
+    gl.bindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(0, 0, camera.imageWidth, camera.imageHeight);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    if (markers.empty())
+        return 0;
+
+    frame++;
+    fillVertices(markers);
+
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    loadPerspectiveMatrix(camera, SCENE_NEAR_PLANE, SCENE_FAR_PLANE);
+
+    // vertices are in camera space already
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LEQUAL);
+    glEnable(GL_TEXTURE_2D);
+    glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_DECAL);
+    glBindTexture(GL_TEXTURE_2D, atlas);
+
+    GLsizei stride = VERTEX_FLOATS * sizeof(GLfloat);
+
+    gl.bindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    gl.bufferData(GL_ARRAY_BUFFER, std::ptrdiff_t(vertices.size() * sizeof(GLfloat)), vertices.data(), GL_STREAM_DRAW);
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glVertexPointer(3, GL_FLOAT, stride, nullptr);
+    glTexCoordPointer(2, GL_FLOAT, stride, reinterpret_cast<const void*>(3 * sizeof(GLfloat)));
+
+    glDrawArrays(GL_TRIANGLES, 0, GLsizei(vertices.size() / VERTEX_FLOATS));
+
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    gl.bindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glDisable(GL_TEXTURE_2D);
+    glPopMatrix();
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+
+    return int(vertices.size() / (6 * VERTEX_FLOATS));
+}
+
+
+void SceneRenderer::unbind() {
+    getGLFunctions().bindFramebuffer(GL_FRAMEBUFFER, 0);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Marker.h"
+#include "Camera.h"
+#include "GLFunctions.h"
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+
+const int SCENE_TEXTURE_SIZE = 64;      // pixels per marker in the atlas
+const int SCENE_ATLAS_CELLS  = 1024;    // distinct markers the atlas holds at once
+
+
+// Renders many markers at once into an offscreen framebuffer, e.g. to load test the detector.
+// Marker images (createMarkerImage() layout) are packed into one texture atlas, every marker
+// becomes two triangles of a vertex buffer and the whole scene is a single glDrawArrays().
+// Atlas cells are uploaded on first use and the least recently drawn ones are reused for
+// new IDs, so scenes with changing IDs upload only the markers that are new.
+// Needs framebuffer objects (OpenGL 3.0), the GLUT window of the context can stay hidden.
+class SceneRenderer {
+public:
+    SceneRenderer(const Camera& camera, int textureSize = SCENE_TEXTURE_SIZE, int atlasCells = SCENE_ATLAS_CELLS);
+    ~SceneRenderer();
+
+    SceneRenderer(const SceneRenderer&) = delete;
+    SceneRenderer& operator=(const SceneRenderer&) = delete;
+
+    // Draw the markers into the framebuffer and leave it bound, so glReadPixels()
+    // or ViewReadback read the scene. Only the first atlasCells distinct markers of
+    // a frame fit into the atlas, the rest is left out. Returns the number drawn.
+    int render(const std::vector<Marker>& markers);
+
+    // Bind the default framebuffer again, e.g. to draw into the window
+    void unbind();
+
+private:
+    struct AtlasCell {
+        std::uint64_t   key;            // MarkerImageCache::getKey()
+        int             lastFrame;      // -1 while unused
+    };
+
+    // Atlas cell of a marker, uploads its image unless the cell holds it already.
+    // -1 if every cell holds another marker of the current frame.
+    int getAtlasCell(const Marker& marker);
+
+    // Two textured triangles per marker in OpenGL camera space
+    void fillVertices(const std::vector<Marker>& markers);
+
+    Camera                      camera;
+    int                         textureSize;
+
+    GLuint                      framebuffer;
+    GLuint                      colorBuffer;
+    GLuint                      depthBuffer;
+    GLuint                      vertexBuffer;
+
+    GLuint                      atlas;
+    int                         atlasCols;          // cells per row
+    int                         atlasRows;
+    std::vector<AtlasCell>      cells;              // row-major from the bottom, as OpenGL textures
+    std::unordered_map<std::uint64_t, int> cellIndex;   // cell of every uploaded marker image
+    int                         frame;              // render() calls so far
+
+    std::vector<GLfloat>        vertices;           // x, y, z, u, v
+};
@@ -0,0 +1,150 @@
+#include "SoftwareRendering.h"
+#include "Marker.h"
+#include "Camera.h"
+#include "MarkerImageCache.h"
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cassert>
+#include <numeric>
+
+
+const double NEAR_PLANE = 0.1;      // the same clipping distance as the OpenGL view
+
+
+// OpenGL modelview rotation: glRotated() around OX, then OY, then OZ
+cv::Mat getRotationMatrix(const Rotation& r) {
+    static const double PI = 3.14159265358979323846;
+
+    double ox = r.ox * PI / 180.0;
+    double oy = r.oy * PI / 180.0;
+    double oz = r.oz * PI / 180.0;
+
+    cv::Mat rx = (cv::Mat_<double>(3, 3) <<
+        1.0,    0.0,            0.0,
+        0.0,    std::cos(ox),  -std::sin(ox),
+        0.0,    std::sin(ox),   std::cos(ox));
+
+    cv::Mat ry = (cv::Mat_<double>(3, 3) <<
+        std::cos(oy),   0.0,    std::sin(oy),
+        0.0,            1.0,    0.0,
+       -std::sin(oy),   0.0,    std::cos(oy));
+
+    cv::Mat rz = (cv::Mat_<double>(3, 3) <<
+        std::cos(oz),  -std::sin(oz),   0.0,
+        std::sin(oz),   std::cos(oz),   0.0,
+        0.0,            0.0,            1.0);
+
+    return rx * ry * rz;
+}
+
+
+// Check if the whole marker lies in front of the near plane
+bool isMarkerVisible(const Marker& marker) {
+    double half = Marker::MARKER_SIZE / 2.0;
+    cv::Mat rotation = getRotationMatrix(marker.r);
+
+    for (double x : { -half, half }) {
+        for (double y : { -half, half }) {
+            double z = rotation.at<double>(2, 0) * x + rotation.at<double>(2, 1) * y + marker.t.z;
+
+            if (z > -NEAR_PLANE)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+
+cv::Mat getMarkerHomography(const Camera& camera, const Marker& marker, int markerSizePx) {
+    double half = Marker::MARKER_SIZE / 2.0;
+    double k = Marker::MARKER_SIZE / markerSizePx;
+
+    // marker image pixel -> marker plane (texture rows go downwards, marker Y goes upwards)
+    cv::Mat imageToPlane = (cv::Mat_<double>(3, 3) <<
+        k,      0.0,    0.5 * k - half,
+        0.0,   -k,      half - 0.5 * k,
+        0.0,    0.0,    1.0);
+
+    // marker plane -> OpenGL camera space
+    cv::Mat rotation = getRotationMatrix(marker.r);
+    cv::Mat planeToCamera = (cv::Mat_<double>(3, 3) <<
+        rotation.at<double>(0, 0),  rotation.at<double>(0, 1),  marker.t.x,
+        rotation.at<double>(1, 0),  rotation.at<double>(1, 1),  marker.t.y,
+        rotation.at<double>(2, 0),  rotation.at<double>(2, 1),  marker.t.z);
+
+    // OpenGL camera space -> OpenCV camera space (180 degrees around OX)
+    cv::Mat openGLToOpenCV = (cv::Mat_<double>(3, 3) <<
+        1.0,    0.0,    0.0,
+        0.0,   -1.0,    0.0,
+        0.0,    0.0,   -1.0);
+
+    // OpenGL samples pixel centers, OpenCV puts them at integer coordinates
+    cv::Mat pixelCenter = (cv::Mat_<double>(3, 3) <<
+        1.0,    0.0,   -0.5,
+        0.0,    1.0,   -0.5,
+        0.0,    0.0,    1.0);
+
+    return pixelCenter * getCameraMatrix(camera) * openGLToOpenCV * planeToCamera * imageToPlane;
+}
+
+
+bool projectMarker(const Camera& camera, const Marker& marker, std::vector<cv::Point2f>& corners) {
+    if (!isMarkerVisible(marker))
+        return false;
+
+    // edges of a single pixel marker image
+    static const std::vector<cv::Point2f> imageCorners = {
+        { -0.5f, -0.5f }, { 0.5f, -0.5f }, { 0.5f, 0.5f }, { -0.5f, 0.5f } };
+
+    cv::perspectiveTransform(imageCorners, corners, getMarkerHomography(camera, marker, 1));
+
+    if (hasDistortion(camera)) {
+        for (auto& corner : corners) {
+            corner = distortPoint(camera, corner);
+        }
+    }
+
+    return true;
+}
+
+
+void renderMarker(const Camera& camera, const Marker& marker, const cv::Mat& markerImg, cv::Mat& sceneRGB) {
+    assert(markerImg.rows == markerImg.cols);
+    assert(markerImg.type() == sceneRGB.type());
+
+    if (!isMarkerVisible(marker))
+        return;
+
+    auto homography = getMarkerHomography(camera, marker, markerImg.cols);
+
+    // transparent border leaves everything outside of the marker untouched
+    cv::warpPerspective(markerImg, sceneRGB, homography, sceneRGB.size(), cv::INTER_LINEAR, cv::BORDER_TRANSPARENT);
+}
+
+
+void renderScene(const Camera& camera, const std::vector<Marker>& markers, int textureSize, cv::Mat& sceneRGB) {
+    sceneRGB.create(camera.imageHeight, camera.imageWidth, CV_8UC3);
+    sceneRGB = CV_RGB(0, 0, 0);
+
+    // painter's algorithm instead of a depth buffer: the farthest marker goes first
+    std::vector<std::size_t> order(markers.size());
+    std::iota(std::begin(order), std::end(order), 0);
+
+    std::sort(std::begin(order), std::end(order), [&markers](std::size_t a, std::size_t b) {
+        return markers[a].t.z < markers[b].t.z;
+    });
+
+    for (auto i : order) {
+        auto markerImg = MarkerImageCache::shared().get(markers[i], textureSize);
+        renderMarker(camera, markers[i], markerImg, sceneRGB);
+    }
+}
+
+
+cv::Mat renderScene(const Camera& camera, const std::vector<Marker>& markers, int textureSize) {
+    cv::Mat sceneRGB;
+    renderScene(camera, markers, textureSize, sceneRGB);
+    return sceneRGB;
+}
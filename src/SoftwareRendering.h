@@ -0,0 +1,29 @@
+#pragma once
+
+#include "Marker.h"
+#include "Camera.h"
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+
+// CPU counterpart of render() + getRenderedView(), no OpenGL context needed.
+// Marker images use the createMarkerImage() layout and come from MarkerImageCache::shared(),
+// the background is black.
+cv::Mat renderScene(const Camera& camera, const std::vector<Marker>& markers, int textureSize);
+
+// Same as above, reuses sceneRGB if it already has the right size and type
+void    renderScene(const Camera& camera, const std::vector<Marker>& markers, int textureSize, cv::Mat& sceneRGB);
+
+// Draws a single marker image over the scene (no depth test)
+void    renderMarker(const Camera& camera, const Marker& marker, const cv::Mat& markerImg, cv::Mat& sceneRGB);
+
+// OpenGL modelview rotation of a marker: glRotated() around OX, then OY, then OZ
+cv::Mat getRotationMatrix(const Rotation& rotation);
+
+// Returns a 3x3 homography mapping marker image pixels to camera image pixels
+cv::Mat getMarkerHomography(const Camera& camera, const Marker& marker, int markerSizePx);
+
+// Outer marker corners in camera image pixels (upper left first, clockwise), lens distortion
+// included. False if the marker is not entirely in front of the near plane.
+bool    projectMarker(const Camera& camera, const Marker& marker, std::vector<cv::Point2f>& corners);
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+
+// Bounded lock-free single-producer single-consumer ring of trivially copyable
+// values (frame pointers). The producer may also drop the oldest element when
+// the ring is full; both ends then race for the head with a compare-exchange.
+template <typename T>
+class SpscQueue {
+    static const std::size_t CACHE_LINE = 64;
+
+public:
+    explicit SpscQueue(std::size_t capacity)
+        : slots(new std::atomic<T>[capacity]), capacity(capacity), head(0), tail(0) {
+        assert(capacity > 0);
+    }
+
+    // Producer only, false if the queue is full
+    bool push(T value) {
+        std::uint64_t t = tail.load(std::memory_order_relaxed);
+
+        if (t - head.load(std::memory_order_acquire) >= capacity)
+            return false;
+
+        slots[t % capacity].store(value, std::memory_order_relaxed);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Producer only, removes the oldest element to make room if the queue is full.
+    // Returns true if an element was removed, it's written to dropped.
+    bool pushDropOldest(T value, T& dropped) {
+        bool hasDropped = false;
+
+        // at most two rounds, only this thread adds elements
+        while (!push(value)) {
+            hasDropped = pop(dropped) || hasDropped;
+        }
+
+        return hasDropped;
+    }
+
+    // Consumer (or the producer dropping), false if the queue is empty
+    bool pop(T& value) {
+        std::uint64_t h = head.load(std::memory_order_acquire);
+
+        while (h != tail.load(std::memory_order_acquire)) {
+            // the slot can't be reused while head still equals h, the exchange fails otherwise
+            value = slots[h % capacity].load(std::memory_order_relaxed);
+
+            if (head.compare_exchange_weak(h, h + 1, std::memory_order_acq_rel, std::memory_order_acquire))
+                return true;
+        }
+
+        return false;
+    }
+
+    std::size_t size() const {
+        return std::size_t(tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire));
+    }
+
+private:
+    std::unique_ptr<std::atomic<T>[]> slots;
+    const std::size_t capacity;
+
+    // padded apart, each index is mostly written by one side (no alignas,
+    // C++11 operator new ignores over-alignment)
+    char padding0[CACHE_LINE];
+    std::atomic<std::uint64_t> head;
+    char padding1[CACHE_LINE];
+    std::atomic<std::uint64_t> tail;
+    char padding2[CACHE_LINE];
+};
@@ -0,0 +1,130 @@
+#include "Statistics.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <numeric>
+
+
+struct Summary {
+    double min, avg, p99;
+};
+
+
+Summary summarize(std::vector<double>& values) {
+    assert(!values.empty());
+
+    std::sort(std::begin(values), std::end(values));
+
+    double sum = std::accumulate(std::begin(values), std::end(values), 0.0);
+    auto p99Index = std::size_t(std::ceil(0.99 * (values.size() - 1)));
+
+    return{ values.front(), sum / values.size(), values[p99Index] };
+}
+
+
+const char* getStageName(RecognitionStage stage) {
+    switch (stage) {
+        case STAGE_GREY:        return "grey";
+        case STAGE_CONTOURS:    return "contours";
+        case STAGE_QUADS:       return "quads";
+        case STAGE_UNDISTORT:   return "undistort";
+        case STAGE_DECODE:      return "decode";
+        case STAGE_POSE:        return "pose";
+        case STAGE_TOTAL:       return "total";
+        case NUM_STAGES:        break;
+    }
+
+    assert(false);
+    return "";
+}
+
+
+void addStats(RecognitionStats& total, const RecognitionStats& stats) {
+    for (int stage = 0; stage < NUM_STAGES; stage++) {
+        total.stageNs[stage] += stats.stageNs[stage];
+    }
+
+    total.numContours += stats.numContours;
+    total.numQuads    += stats.numQuads;
+    total.numWarped   += stats.numWarped;
+    total.numValid    += stats.numValid;
+    total.numMarkers  += stats.numMarkers;
+}
+
+
+RollingStats::RollingStats(std::size_t windowSize)
+    : windowSize(windowSize), next(0), frames(0) {
+    assert(windowSize > 0);
+    window.reserve(windowSize);
+}
+
+
+void RollingStats::add(const RecognitionStats& stats) {
+    if (window.size() < windowSize) {
+        window.push_back(stats);
+    }
+    else {
+        window[next] = stats;
+    }
+
+    next = (next + 1) % windowSize;
+    frames++;
+}
+
+
+std::size_t RollingStats::size() const {
+    return window.size();
+}
+
+
+std::size_t RollingStats::totalFrames() const {
+    return frames;
+}
+
+
+void RollingStats::print(std::ostream& out) const {
+    if (window.empty()) {
+        out << "No frames recorded\n";
+        return;
+    }
+
+    auto flags = out.flags();
+    auto precision = out.precision();
+    std::vector<double> values(window.size());
+
+    auto collect = [&](const std::function<double(const RecognitionStats&)>& get) {
+        std::transform(std::begin(window), std::end(window), std::begin(values), get);
+        return summarize(values);
+    };
+
+    out << std::fixed << std::setprecision(1) <<
+        "Last " << window.size() << " of " << frames << " frames\n" <<
+        std::left << std::setw(12) << "stage" << std::right <<
+        std::setw(12) << "min us" << std::setw(12) << "avg us" << std::setw(12) << "p99 us" << "\n";
+
+    for (int stage = 0; stage < NUM_STAGES; stage++) {
+        auto s = collect([stage](const RecognitionStats& r) { return r.stageNs[stage] / 1000.0; });
+
+        out << std::left << std::setw(12) << getStageName(RecognitionStage(stage)) << std::right <<
+            std::setw(12) << s.min << std::setw(12) << s.avg << std::setw(12) << s.p99 << "\n";
+    }
+
+    auto contours = collect([](const RecognitionStats& r) { return double(r.numContours); });
+    auto quads    = collect([](const RecognitionStats& r) { return double(r.numQuads); });
+    auto warped   = collect([](const RecognitionStats& r) { return double(r.numWarped); });
+    auto valid    = collect([](const RecognitionStats& r) { return double(r.numValid); });
+    auto markers  = collect([](const RecognitionStats& r) { return double(r.numMarkers); });
+
+    out << "avg funnel: " <<
+        "contours=" << contours.avg << " "
+        "quads=" << quads.avg << " "
+        "warped=" << warped.avg << " "
+        "valid=" << valid.avg << " "
+        "markers=" << markers.avg << "\n";
+
+    out.flags(flags);
+    out.precision(precision);
+}
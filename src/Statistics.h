@@ -0,0 +1,111 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+
+enum RecognitionStage {
+    STAGE_GREY,
+    STAGE_CONTOURS,
+    STAGE_QUADS,
+    STAGE_UNDISTORT,
+    STAGE_DECODE,
+    STAGE_POSE,
+    STAGE_TOTAL,
+    NUM_STAGES
+};
+
+
+// Per-frame durations and the candidate funnel of recognizeMarkers().
+// Per-candidate stages (undistort, decode, pose) are summed over all threads.
+struct RecognitionStats {
+    double stageNs[NUM_STAGES] = {};
+
+    int numContours = 0;    // contours long enough to be a marker
+    int numQuads    = 0;    // convex quadrangles
+    int numWarped   = 0;    // undistorted marker images
+    int numValid    = 0;    // passed the frame and corner checks
+    int numMarkers  = 0;    // recognized markers
+};
+
+
+// Stage name for printing
+const char* getStageName(RecognitionStage stage);
+
+
+// Add durations and counts of a partial run (e.g. one region) to total
+void addStats(RecognitionStats& total, const RecognitionStats& stats);
+
+
+// Adds elapsed time to a stage duration; does nothing without stats
+class StageTimer {
+public:
+    explicit StageTimer(RecognitionStats* stats)
+        : StageTimer(stats ? stats->stageNs : nullptr) {}
+
+    // Accumulate into a NUM_STAGES array, e.g. per-candidate durations
+    explicit StageTimer(double* stageNs)
+        : stats(stageNs) {
+        if (stats) {
+            start = last = std::chrono::steady_clock::now();
+        }
+    }
+
+    // Attribute the time since the previous lap to the given stage
+    void lap(RecognitionStage stage) {
+        if (stats) {
+            auto now = std::chrono::steady_clock::now();
+            stats[stage] += elapsedNs(last, now);
+            last = now;
+        }
+    }
+
+    // Drop the time since the previous lap, when it was accounted for elsewhere
+    void skip() {
+        if (stats) {
+            last = std::chrono::steady_clock::now();
+        }
+    }
+
+    // Set the total duration
+    void stop() {
+        if (stats) {
+            stats[STAGE_TOTAL] = elapsedNs(start, std::chrono::steady_clock::now());
+        }
+    }
+
+private:
+    typedef std::chrono::steady_clock::time_point TimePoint;
+
+    static double elapsedNs(TimePoint from, TimePoint to) {
+        return double(std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count());
+    }
+
+    double* stats;
+    TimePoint start, last;
+};
+
+
+// Min/avg/p99 of the last N frames
+class RollingStats {
+public:
+    explicit RollingStats(std::size_t windowSize = 300);
+
+    void add(const RecognitionStats& stats);
+
+    // Number of frames in the window
+    std::size_t size() const;
+
+    // Number of frames added since construction
+    std::size_t totalFrames() const;
+
+    void print(std::ostream& out) const;
+
+private:
+    std::vector<RecognitionStats> window;
+    std::size_t windowSize;
+    std::size_t next;
+    std::size_t frames;
+};
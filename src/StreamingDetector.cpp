@@ -0,0 +1,184 @@
+#include "StreamingDetector.h"
+
+#include <cassert>
+#include <chrono>
+#include <utility>
+
+
+const int SPINS_BEFORE_SLEEP = 64;                          // yields before an empty queue sleeps
+const std::chrono::microseconds IDLE_SLEEP{ 50 };
+
+
+struct StreamingDetector::Frame {
+    std::uint64_t                           id = 0;
+    std::chrono::steady_clock::time_point   submitted;
+    cv::Mat                                 sceneRGB;
+    bool                                    bottomUp = false;
+    DetectorFrame                           buffers;
+    RecognitionStats                        stats;
+    std::atomic<bool>                       free{ true };
+};
+
+
+StreamingDetector::StreamingDetector(const Camera& camera, const DetectorParams& detectorParams,
+                                     const StreamingParams& streamingParams)
+    : detector(camera, detectorParams), params(streamingParams),
+      input(streamingParams.queueCapacity), grey(streamingParams.queueCapacity),
+      quads(streamingParams.queueCapacity), output(streamingParams.queueCapacity),
+      nextFrameId(0), dropped(0), running(true) {
+
+    // every queue full, every stage busy and one more being submitted
+    std::size_t numFrames = 4 * params.queueCapacity + 4;
+
+    for (std::size_t i = 0; i < numFrames; i++) {
+        frames.emplace_back(new Frame());
+    }
+
+    threads.emplace_back(&StreamingDetector::greyStage, this);
+    threads.emplace_back(&StreamingDetector::quadStage, this);
+    threads.emplace_back(&StreamingDetector::decodeStage, this);
+}
+
+
+StreamingDetector::~StreamingDetector() {
+    running = false;
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+
+const MarkerDetector& StreamingDetector::getDetector() const {
+    return detector;
+}
+
+
+std::uint64_t StreamingDetector::numDropped() const {
+    return dropped.load();
+}
+
+
+StreamingDetector::Frame* StreamingDetector::acquireFrame() {
+    for (auto& frame : frames) {
+        bool expected = true;
+
+        if (frame->free.compare_exchange_strong(expected, false))
+            return frame.get();
+    }
+
+    assert(false && "Frame pool exhausted");
+    return nullptr;
+}
+
+
+void StreamingDetector::releaseFrame(Frame* frame) {
+    frame->sceneRGB.release();
+    frame->free = true;
+}
+
+
+void StreamingDetector::pushFrame(FrameQueue& queue, Frame* frame) {
+    if (params.overflow == OVERFLOW_DROP_OLDEST) {
+        Frame* oldest;
+
+        if (queue.pushDropOldest(frame, oldest)) {
+            releaseFrame(oldest);
+            dropped++;
+        }
+        return;
+    }
+
+    // backpressure, the producer waits for the consumer
+    while (!queue.push(frame)) {
+        if (!running) {
+            releaseFrame(frame);
+            return;
+        }
+        std::this_thread::yield();
+    }
+}
+
+
+StreamingDetector::Frame* StreamingDetector::popFrame(FrameQueue& queue) {
+    Frame* frame;
+    int spins = 0;
+
+    while (running) {
+        if (queue.pop(frame))
+            return frame;
+
+        if (++spins < SPINS_BEFORE_SLEEP) {
+            std::this_thread::yield();
+        }
+        else {
+            std::this_thread::sleep_for(IDLE_SLEEP);
+        }
+    }
+
+    return nullptr;
+}
+
+
+std::uint64_t StreamingDetector::submit(const cv::Mat& sceneRGB, bool bottomUp) {
+    Frame* frame = acquireFrame();
+
+    frame->id = nextFrameId++;
+    frame->submitted = std::chrono::steady_clock::now();
+    frame->sceneRGB = sceneRGB;
+    frame->bottomUp = bottomUp;
+    frame->stats = {};
+
+    pushFrame(input, frame);
+
+    return frame->id;
+}
+
+
+bool StreamingDetector::poll(StreamingResult& result) {
+    Frame* frame;
+
+    if (!output.pop(frame))
+        return false;
+
+    result.frameId = frame->id;
+    result.stats = frame->stats;
+
+    // swap, so both sides keep their buffers
+    std::swap(result.markers, frame->buffers.markers);
+
+    releaseFrame(frame);
+    return true;
+}
+
+
+void StreamingDetector::greyStage() {
+    while (Frame* frame = popFrame(input)) {
+        detector.convertToGrey(frame->sceneRGB, PIXEL_RGB, frame->bottomUp, frame->buffers, &frame->stats);
+        frame->sceneRGB.release();
+
+        pushFrame(grey, frame);
+    }
+}
+
+
+void StreamingDetector::quadStage() {
+    while (Frame* frame = popFrame(grey)) {
+        detector.findQuads(frame->buffers, &frame->stats);
+
+        pushFrame(quads, frame);
+    }
+}
+
+
+void StreamingDetector::decodeStage() {
+    while (Frame* frame = popFrame(quads)) {
+        detector.nextFrame();
+        detector.decodeQuads(frame->buffers, &frame->stats);
+
+        auto latency = std::chrono::steady_clock::now() - frame->submitted;
+        frame->stats.stageNs[STAGE_TOTAL] = double(std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count());
+
+        pushFrame(output, frame);
+    }
+}
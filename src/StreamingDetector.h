@@ -0,0 +1,91 @@
+#pragma once
+
+#include "Camera.h"
+#include "MarkerDetector.h"
+#include "Recognition.h"
+#include "SpscQueue.h"
+#include "Statistics.h"
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+
+enum OverflowPolicy {
+    OVERFLOW_DROP_OLDEST,   // replace the oldest queued frame, producers never wait
+    OVERFLOW_BLOCK          // wait until the next stage takes a frame, submit() waits
+                            // for poll() once every queue is full
+};
+
+
+struct StreamingParams {
+    std::size_t     queueCapacity   = 2;                        // frames between two stages
+    OverflowPolicy  overflow        = OVERFLOW_DROP_OLDEST;
+};
+
+
+struct StreamingResult {
+    std::uint64_t               frameId = 0;
+    std::vector<MarkerScore>    markers;
+    RecognitionStats            stats;          // STAGE_TOTAL is the submit -> result latency
+};
+
+
+// MarkerDetector split into a grey conversion, a quad detection and a decode/pose stage,
+// each on its own thread and connected by bounded lock-free queues. Throughput is bound
+// by the slowest stage, not by the sum of them. submit() and poll() may be called from
+// two different threads, but neither of them from more than one.
+class StreamingDetector {
+public:
+    StreamingDetector(const Camera& camera, const DetectorParams& detectorParams = DetectorParams(),
+                      const StreamingParams& streamingParams = StreamingParams());
+    ~StreamingDetector();
+
+    StreamingDetector(const StreamingDetector&) = delete;
+    StreamingDetector& operator=(const StreamingDetector&) = delete;
+
+    // Queue an RGB frame and return its id. The image data is shared, not copied,
+    // so don't write into it afterwards. A bottomUp frame has its last row first.
+    std::uint64_t submit(const cv::Mat& sceneRGB, bool bottomUp = false);
+
+    // Take the oldest finished frame, false if there is none yet.
+    // Results come in submission order, dropped frames are skipped.
+    bool poll(StreamingResult& result);
+
+    // Frames dropped by full queues so far
+    std::uint64_t numDropped() const;
+
+    const MarkerDetector& getDetector() const;
+
+private:
+    struct Frame;
+    typedef SpscQueue<Frame*> FrameQueue;
+
+    // Free frame from the pool, there is one for every queue slot and thread
+    Frame* acquireFrame();
+    void releaseFrame(Frame* frame);
+
+    // Push according to the overflow policy, dropped frames return to the pool
+    void pushFrame(FrameQueue& queue, Frame* frame);
+
+    // Pop with backoff, nullptr once the detector is stopping
+    Frame* popFrame(FrameQueue& queue);
+
+    void greyStage();
+    void quadStage();
+    void decodeStage();
+
+    MarkerDetector                          detector;
+    StreamingParams                         params;
+
+    std::vector<std::unique_ptr<Frame>>     frames;
+    FrameQueue                              input, grey, quads, output;
+
+    std::uint64_t                           nextFrameId;
+    std::atomic<std::uint64_t>              dropped;
+    std::atomic<bool>                       running;
+    std::vector<std::thread>                threads;
+};
@@ -0,0 +1,163 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cassert>
+
+
+const std::size_t TASKS_PER_THREAD = 4;     // chunks per thread, more chunks balance better
+
+
+ThreadPool::ThreadPool(int numWorkers)
+    : queued(0), stopping(false) {
+    assert(numWorkers >= 0);
+
+    for (int i = 0; i < numWorkers; i++) {
+        workers.emplace_back(new Worker());
+    }
+
+    for (int i = 0; i < numWorkers; i++) {
+        threads.emplace_back(&ThreadPool::workerLoop, this, std::size_t(i));
+    }
+}
+
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock{ sleepMutex };
+        stopping = true;
+    }
+    sleepCondition.notify_all();
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+
+int ThreadPool::size() const {
+    return int(workers.size()) + 1;
+}
+
+
+int ThreadPool::defaultNumWorkers() {
+    int hardwareThreads = int(std::thread::hardware_concurrency());
+    return std::max(hardwareThreads - 1, 0);
+}
+
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool;
+    return pool;
+}
+
+
+void ThreadPool::parallelFor(std::size_t count, const std::function<void(std::size_t)>& body) {
+    if (count == 0) return;
+
+    if (workers.empty() || count == 1) {
+        for (std::size_t i = 0; i < count; i++) {
+            body(i);
+        }
+        return;
+    }
+
+    Job job;
+    job.body = &body;
+    job.remaining = count;
+
+    // split into chunks dealt round-robin, idle workers steal the rest
+    std::size_t numTasks = std::min(count, std::size_t(size()) * TASKS_PER_THREAD);
+    std::size_t begin = 0;
+
+    for (std::size_t i = 0; i < numTasks; i++) {
+        std::size_t end = count * (i + 1) / numTasks;
+        auto& worker = *workers[i % workers.size()];
+
+        std::lock_guard<std::mutex> lock{ worker.mutex };
+        worker.tasks.push_back({ &job, begin, end });
+        begin = end;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock{ sleepMutex };
+        queued += int(numTasks);
+    }
+    sleepCondition.notify_all();
+
+    // help instead of blocking, any job's task brings ours closer
+    Task task;
+
+    while (job.remaining.load() > 0) {
+        if (popTask(workers.size(), task)) {
+            runTask(task);
+        }
+        else {
+            std::unique_lock<std::mutex> lock{ doneMutex };
+            doneCondition.wait(lock, [&] { return job.remaining.load() == 0 || queued.load() > 0; });
+        }
+    }
+}
+
+
+void ThreadPool::workerLoop(std::size_t self) {
+    Task task;
+
+    while (true) {
+        if (popTask(self, task)) {
+            runTask(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock{ sleepMutex };
+        sleepCondition.wait(lock, [&] { return stopping || queued.load() > 0; });
+
+        if (stopping && queued.load() == 0) return;
+    }
+}
+
+
+bool ThreadPool::popTask(std::size_t self, Task& task) {
+    std::size_t numWorkers = workers.size();
+
+    // self == numWorkers is a caller thread, it only steals
+    if (self < numWorkers) {
+        auto& own = *workers[self];
+        std::lock_guard<std::mutex> lock{ own.mutex };
+
+        if (!own.tasks.empty()) {
+            task = own.tasks.back();
+            own.tasks.pop_back();
+            queued--;
+            return true;
+        }
+    }
+
+    for (std::size_t i = 1; i <= numWorkers; i++) {
+        auto& victim = *workers[(self + i) % numWorkers];
+        std::lock_guard<std::mutex> lock{ victim.mutex };
+
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+            queued--;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+void ThreadPool::runTask(const Task& task) {
+    for (std::size_t i = task.begin; i < task.end; i++) {
+        (*task.job->body)(i);
+    }
+
+    std::size_t done = task.end - task.begin;
+
+    // the job lives on the caller's stack, don't touch it after the last decrement
+    if (task.job->remaining.fetch_sub(done) == done) {
+        std::lock_guard<std::mutex> lock{ doneMutex };
+        doneCondition.notify_all();
+    }
+}
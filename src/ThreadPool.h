@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// Persistent work-stealing thread pool. Every worker owns a deque of index ranges,
+// pops from its back and steals from the front of the others when it runs dry.
+// The thread calling parallelFor() helps until its own job is finished, so nested
+// and concurrent parallelFor() calls can't deadlock.
+class ThreadPool {
+public:
+    // numWorkers excludes the calling thread, 0 runs everything on the caller
+    explicit ThreadPool(int numWorkers = defaultNumWorkers());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Calls body(i) for every i in [0, count) and returns once all calls are done.
+    // Calls may run on any thread and in any order.
+    void parallelFor(std::size_t count, const std::function<void(std::size_t)>& body);
+
+    // Number of threads taking part in parallelFor(), including the caller
+    int size() const;
+
+    // One worker less than the hardware threads, the caller makes up for it
+    static int defaultNumWorkers();
+
+    // Pool shared by every detector of the process
+    static ThreadPool& shared();
+
+private:
+    struct Job {
+        const std::function<void(std::size_t)>* body;
+        std::atomic<std::size_t> remaining;
+    };
+
+    struct Task {
+        Job* job;
+        std::size_t begin, end;
+    };
+
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void workerLoop(std::size_t self);
+
+    // Own tasks first (from the back), then steal from the others (from the front)
+    bool popTask(std::size_t self, Task& task);
+
+    void runTask(const Task& task);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+
+    std::atomic<int> queued;            // tasks waiting in the deques
+    std::mutex sleepMutex;
+    std::condition_variable sleepCondition;
+    bool stopping;
+
+    std::mutex doneMutex;
+    std::condition_variable doneCondition;
+};
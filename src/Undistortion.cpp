@@ -0,0 +1,106 @@
+#include "Undistortion.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+
+// True if both cameras have the same undistortion grid
+bool isSameLens(const Camera& a, const Camera& b) {
+    return
+        a.imageWidth == b.imageWidth && a.imageHeight == b.imageHeight &&
+        a.focalX == b.focalX && a.focalY == b.focalY && a.principalX == b.principalX && a.principalY == b.principalY &&
+        a.k1 == b.k1 && a.k2 == b.k2 && a.p1 == b.p1 && a.p2 == b.p2 && a.k3 == b.k3;
+}
+
+
+UndistortionMap::UndistortionMap() : cols(0), rows(0) {
+}
+
+
+UndistortionMap::UndistortionMap(const Camera& camera) : cols(0), rows(0) {
+    if (!hasDistortion(camera))
+        return;
+
+    assert(camera.imageWidth > 0 && camera.imageHeight > 0);
+
+    // the last nodes lie on or past the image edges
+    cols = (camera.imageWidth + UNDISTORTION_GRID_STEP - 1) / UNDISTORTION_GRID_STEP + 1;
+    rows = (camera.imageHeight + UNDISTORTION_GRID_STEP - 1) / UNDISTORTION_GRID_STEP + 1;
+    nodes = getGrid(camera, cols, rows);
+}
+
+
+std::shared_ptr<const UndistortionMap::Grid> UndistortionMap::getGrid(const Camera& camera, int cols, int rows) {
+    static std::mutex mutex;
+    static std::deque<std::pair<Camera, std::shared_ptr<const Grid>>> grids;    // most recently used first
+
+    std::lock_guard<std::mutex> lock{ mutex };
+
+    for (auto it = grids.begin(); it != grids.end(); ++it) {
+        if (isSameLens(it->first, camera)) {
+            auto entry = *it;
+            grids.erase(it);
+            grids.push_front(entry);
+            return entry.second;
+        }
+    }
+
+    std::shared_ptr<Grid> grid = std::make_shared<Grid>(cols * rows);
+
+    for (int j = 0; j < rows; j++) {
+        for (int i = 0; i < cols; i++) {
+            cv::Point2d node{ double(i * UNDISTORTION_GRID_STEP), double(j * UNDISTORTION_GRID_STEP) };
+            (*grid)[j * cols + i] = undistortPoint(camera, node);
+        }
+    }
+
+    // maps still using an evicted grid keep it alive
+    grids.emplace_front(camera, grid);
+
+    if (grids.size() > UNDISTORTION_CACHE_GRIDS) {
+        grids.pop_back();
+    }
+
+    return grid;
+}
+
+
+bool UndistortionMap::empty() const {
+    return !nodes;
+}
+
+
+cv::Point2f UndistortionMap::undistort(const cv::Point2f& point) const {
+    assert(!empty());
+
+    float gridX = point.x / UNDISTORTION_GRID_STEP;
+    float gridY = point.y / UNDISTORTION_GRID_STEP;
+
+    // the border cells extend past the grid
+    int i = std::min(std::max(int(std::floor(gridX)), 0), cols - 2);
+    int j = std::min(std::max(int(std::floor(gridY)), 0), rows - 2);
+
+    float fx = gridX - i;
+    float fy = gridY - j;
+
+    const cv::Point2f* top = &(*nodes)[j * cols + i];
+    const cv::Point2f* bottom = top + cols;
+
+    cv::Point2f upper = top[0] + (top[1] - top[0]) * fx;
+    cv::Point2f lower = bottom[0] + (bottom[1] - bottom[0]) * fx;
+
+    return upper + (lower - upper) * fy;
+}
+
+
+void UndistortionMap::undistort(std::vector<cv::Point2f>& points, const cv::Point& origin) const {
+    cv::Point2f offset{ float(origin.x), float(origin.y) };
+
+    for (auto& point : points) {
+        point = undistort(point + offset) - offset;
+    }
+}
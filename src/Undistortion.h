@@ -0,0 +1,44 @@
+#pragma once
+
+#include "Camera.h"
+
+#include <opencv2/opencv.hpp>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+
+const int         UNDISTORTION_GRID_STEP    = 4;    // pixels between the lookup grid nodes
+const std::size_t UNDISTORTION_CACHE_GRIDS  = 4;    // grids of the most recently used cameras kept
+
+
+// Undistortion of single points for a camera with lens distortion. Undistorted pixels
+// are precomputed on a coarse grid over the image and interpolated bilinearly, so only
+// the few points that matter (quad corners) get undistorted instead of whole frames.
+// Maps of the same camera share one grid, the grids of the last UNDISTORTION_CACHE_GRIDS
+// cameras are kept, so short-lived maps (e.g. of recognizeMarkers()) don't rebuild them.
+class UndistortionMap {
+public:
+    UndistortionMap();
+
+    // Grid over camera.imageWidth * camera.imageHeight, empty without distortion
+    explicit UndistortionMap(const Camera& camera);
+
+    bool empty() const;
+
+    // Undistorted scene pixel of a distorted one. Points outside of the image are extrapolated.
+    cv::Point2f undistort(const cv::Point2f& point) const;
+
+    // Undistort points given relative to origin in place, e.g. corners of a scene region
+    void undistort(std::vector<cv::Point2f>& points, const cv::Point& origin = cv::Point()) const;
+
+private:
+    typedef std::vector<cv::Point2f> Grid;
+
+    // Grid of the camera from the cache, built on a miss
+    static std::shared_ptr<const Grid> getGrid(const Camera& camera, int cols, int rows);
+
+    int                         cols;       // grid nodes per row
+    int                         rows;
+    std::shared_ptr<const Grid> nodes;      // undistorted pixels, row-major, nullptr without distortion
+};
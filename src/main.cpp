@@ -4,11 +4,18 @@
 #include "Processing.h"
 
 #include <GL/freeglut.h>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 
 
 void printInterfaceInfo();
 
+// Parses a positive int, false for anything else
+bool parseCount(const char* text, int& count);
+
 int main(int argc, char* argv[]) {
     Camera camera;
     Marker marker;
@@ -22,6 +29,27 @@ int main(int argc, char* argv[]) {
     printInterfaceInfo();
 
     glutInit(&argc, argv);
+
+    // MarkerPos --load-test <markers> <frames>
+    if (argc == 4 && std::strcmp(argv[1], "--load-test") == 0) {
+        Camera hd;
+        hd.imageWidth = 1920;
+        hd.imageHeight = 1080;
+        hd.principalX = 960.0;
+        hd.principalY = 540.0;
+        hd.focalX = hd.focalY = 1500.0;
+
+        int numMarkers, numFrames;
+
+        if (!parseCount(argv[2], numMarkers) || !parseCount(argv[3], numFrames)) {
+            std::cerr << "Usage: MarkerPos --load-test <markers> <frames>, both counts positive\n";
+            return EXIT_FAILURE;
+        }
+
+        runLoadTest(hd, numMarkers, numFrames);
+        return EXIT_SUCCESS;
+    }
+
     initializeGL(camera, marker);
 
     glutMainLoop();
@@ -33,7 +61,8 @@ int main(int argc, char* argv[]) {
 
 void printInterfaceInfo() {
     std::cout <<
-        "MarkerPos - marker rendering and recognition\n\n"
+        "MarkerPos - marker rendering and recognition\n"
+        "MarkerPos --load-test <markers> <frames> - offscreen detector load test\n\n"
         "Interface:\n"
         "  LEFT, RIGHT - move along OX\n"
         "  UP, DOWN - move along OY\n"
@@ -42,8 +71,21 @@ void printInterfaceInfo() {
         "  W, S - rotate around OY\n"
         "  E, D - rotate around OZ\n"
         "  1, 2, 3, 4 - reset rotations and translation\n"
+        "  P - print recognition statistics\n"
         "  ESC - quit\n\n"
         "DT - Euclidean distance between actual and recognized marker positions\n"
         "DR - maximum difference in angles\n";
 }
 
+
+bool parseCount(const char* text, int& count) {
+    char* end = nullptr;
+    errno = 0;
+    long value = std::strtol(text, &end, 10);
+
+    if (end == text || *end != '\0' || errno == ERANGE || value <= 0 || value > INT_MAX)
+        return false;
+
+    count = int(value);
+    return true;
+}